@@ -0,0 +1,968 @@
+#include <bits/stdc++.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "helper.h"
+#include "http_server.h"
+#include "hub_labels.h"
+#include "query_executor.h"
+#include "route_tiers.h"
+#include "synthetic.h"
+using namespace std;
+
+static double msSince(chrono::steady_clock::time_point started) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+}
+
+static TramRouteFinder buildFinder(const SyntheticNetwork& net) {
+    return TramRouteFinder(net.trips, net.tripNames, net.linePrices, net.stationNames, net.stopTimes);
+}
+
+// All-pairs (cost, time): min-plus Floyd-Warshall vs one-to-all batch vs the
+// per-pair findRoute loop of precompute.cpp. The findRoute loop is timed on
+// a random sample of pairs and extrapolated to all N * (N - 1) pairs.
+static void benchMatrix(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %14s %14s %16s\n", "stations", "states", "floyd_ms", "batch_ms", "findRoute_ms(est)");
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        TramRouteFinder finder = buildFinder(net);
+        vector<long long> ids = finder.stationIds();
+        size_t n = ids.size();
+
+        auto started = chrono::steady_clock::now();
+        vector<int32_t> cells = finder.allPairsMatrix(threads);
+        double floydMs = msSince(started);
+
+        vector<pair<long long, long long>> pairs;
+        for (auto a : ids)
+            for (auto b : ids)
+                if (a != b) pairs.emplace_back(a, b);
+        started = chrono::steady_clock::now();
+        auto batch = finder.findRoutes(pairs, threads);
+        double batchMs = msSince(started);
+
+        for (size_t i = 0, cell = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++, cell += 2) {
+                if (i == j) continue;
+                const BatchResult& r = batch[i * (n - 1) + (j < i ? j : j - 1)];
+                if (r.cost != cells[cell] || r.time != cells[cell + 1]) {
+                    fprintf(stderr, "matrix mismatch for %lld -> %lld\n", ids[i], ids[j]);
+                    exit(1);
+                }
+            }
+        }
+
+        mt19937 rng(7);
+        const int samples = 200;
+        started = chrono::steady_clock::now();
+        for (int i = 0; i < samples; i++) {
+            auto [a, b] = pairs[rng() % pairs.size()];
+            finder.findRoute(a, b);
+        }
+        double loopMs = msSince(started) / samples * pairs.size();
+
+        printf("%8zu %8zu %14.1f %14.1f %16.1f\n", n, finder.stateCount(), floydMs, batchMs, loopMs);
+    }
+}
+
+// Latency of k alternative routes for k = 1..10 on random pairs, with k = 0
+// (plain findRoute) as the baseline. The search trees are built once per
+// query, so k only adds candidate filtering.
+static void benchAlternatives(const vector<int>& sizes) {
+    printf("%8s %4s %12s %12s\n", "stations", "k", "avg_ms", "avg_routes");
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        TramRouteFinder finder = buildFinder(net);
+        vector<long long> ids = finder.stationIds();
+
+        mt19937 rng(11);
+        vector<pair<long long, long long>> pairs;
+        while (pairs.size() < 100) {
+            long long a = ids[rng() % ids.size()], b = ids[rng() % ids.size()];
+            if (a != b) pairs.emplace_back(a, b);
+        }
+
+        for (int k = 0; k <= 10; k++) {
+            RouteOptions options;
+            options.alternatives = k;
+            size_t routes = 0;
+            auto started = chrono::steady_clock::now();
+            for (auto [a, b] : pairs) routes += finder.findRoute(a, b, options).alternativeRoutes.size();
+            double perQuery = msSince(started) / pairs.size();
+            printf("%8zu %4d %12.3f %12.2f\n", ids.size(), k, perQuery, (double)routes / pairs.size());
+        }
+    }
+}
+
+static vector<pair<long long, long long>> randomPairs(const vector<long long>& ids, size_t count, unsigned seed) {
+    mt19937 rng(seed);
+    vector<pair<long long, long long>> pairs;
+    while (pairs.size() < count) {
+        long long a = ids[rng() % ids.size()], b = ids[rng() % ids.size()];
+        if (a != b) pairs.emplace_back(a, b);
+    }
+    return pairs;
+}
+
+struct EngineRun {
+    double settled = 0; // mean settled states per query
+    double ms = 0;      // mean latency per query
+};
+
+// Runs every pair through each engine; all engines must agree on (cost, time)
+static vector<EngineRun> compareEngines(TramRouteFinder& finder, const vector<pair<long long, long long>>& pairs,
+                                        const vector<SearchEngine>& engines) {
+    vector<EngineRun> runs(engines.size());
+    for (auto [a, b] : pairs) {
+        pair<int, int> expected;
+        for (size_t e = 0; e < engines.size(); e++) {
+            RouteOptions options;
+            options.engine = engines[e];
+            RouteResult result = finder.findRoute(a, b, options);
+            runs[e].settled += result.stats.labelsSettled;
+            runs[e].ms += result.stats.elapsedMs;
+
+            pair<int, int> got = {result.optimalRoute.totalCost, result.optimalRoute.totalTime};
+            if (e == 0) expected = got;
+            else if (got != expected) {
+                fprintf(stderr, "engines disagree for %lld -> %lld\n", a, b);
+                exit(1);
+            }
+        }
+    }
+    for (auto& run : runs) {
+        run.settled /= pairs.size();
+        run.ms /= pairs.size();
+    }
+    return runs;
+}
+
+// Settled states and latency of the unidirectional and bidirectional
+// engines on random pairs of grid and radial networks.
+static void benchBidirectional(const vector<int>& sizes) {
+    printf("%8s %8s %8s %16s %12s %16s %12s\n", "network", "stations", "states",
+           "uni_settled", "uni_ms", "bi_settled", "bi_ms");
+    for (int size : sizes) {
+        for (string shape : {"grid", "radial"}) {
+            SyntheticNetwork net = shape == "grid" ? gridNetworkOfSize(size) : radialNetworkOfSize(size);
+            TramRouteFinder finder = buildFinder(net);
+            auto pairs = randomPairs(finder.stationIds(), 200, 5);
+            auto runs = compareEngines(finder, pairs, {SearchEngine::Unidirectional, SearchEngine::Bidirectional});
+            printf("%8s %8zu %8zu %16.1f %12.3f %16.1f %12.3f\n", shape.c_str(), net.stationCount(), finder.stateCount(),
+                   runs[0].settled, runs[0].ms, runs[1].settled, runs[1].ms);
+        }
+    }
+}
+
+// Explored states of geometric A* against plain Dijkstra, on grid and
+// radial networks and, when run from the repository root, on gtfs/.
+static void benchAStar(const vector<int>& sizes) {
+    printf("%8s %8s %16s %12s %16s %12s %10s\n", "network", "stations", "dijkstra_settled", "dijkstra_ms",
+           "astar_settled", "astar_ms", "reduction");
+    auto report = [](const string& name, TramRouteFinder& finder) {
+        auto pairs = randomPairs(finder.stationIds(), 200, 9);
+        auto runs = compareEngines(finder, pairs, {SearchEngine::Unidirectional, SearchEngine::AStar});
+        printf("%8s %8zu %16.1f %12.3f %16.1f %12.3f %9.1f%%\n", name.c_str(), finder.stationIds().size(),
+               runs[0].settled, runs[0].ms, runs[1].settled, runs[1].ms, 100 * (1 - runs[1].settled / runs[0].settled));
+    };
+
+    string stopTimes = readFileContent("gtfs/stop_times.txt");
+    if (!stopTimes.empty()) {
+        TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimes);
+        finder.loadStopCoordinates(readFileContent("gtfs/stops.txt"));
+        report("gtfs", finder);
+    }
+    for (int size : sizes) {
+        for (string shape : {"grid", "radial"}) {
+            SyntheticNetwork net = shape == "grid" ? gridNetworkOfSize(size) : radialNetworkOfSize(size);
+            TramRouteFinder finder = buildFinder(net);
+            finder.loadStopCoordinates(net.stopsTxt());
+            report(shape, finder);
+        }
+    }
+}
+
+// ALT (landmark) against geometric A* and plain Dijkstra for a growing
+// number of landmarks, plus the cost of picking them and the table size.
+static void benchAlt(const vector<int>& sizes) {
+    printf("%8s %8s %9s %12s %16s %16s %16s %12s\n", "network", "stations", "landmarks", "build_ms",
+           "dijkstra_settled", "astar_settled", "alt_settled", "alt_ms");
+    auto report = [](const string& name, TramRouteFinder& finder) {
+        auto pairs = randomPairs(finder.stationIds(), 200, 13);
+        for (int k : {1, 4, 8, 16}) {
+            auto started = chrono::steady_clock::now();
+            finder.buildLandmarks(k);
+            double buildMs = msSince(started);
+            auto runs = compareEngines(finder, pairs, {SearchEngine::Unidirectional, SearchEngine::AStar, SearchEngine::ALT});
+            printf("%8s %8zu %9zu %12.2f %16.1f %16.1f %16.1f %12.3f\n", name.c_str(), finder.stationIds().size(),
+                   finder.landmarkCount(), buildMs, runs[0].settled, runs[1].settled, runs[2].settled, runs[2].ms);
+        }
+    };
+
+    string stopTimes = readFileContent("gtfs/stop_times.txt");
+    if (!stopTimes.empty()) {
+        TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimes);
+        finder.loadStopCoordinates(readFileContent("gtfs/stops.txt"));
+        report("gtfs", finder);
+    }
+    for (int size : sizes) {
+        for (string shape : {"grid", "radial"}) {
+            SyntheticNetwork net = shape == "grid" ? gridNetworkOfSize(size) : radialNetworkOfSize(size);
+            TramRouteFinder finder = buildFinder(net);
+            finder.loadStopCoordinates(net.stopsTxt());
+            report(shape, finder);
+        }
+    }
+}
+
+// Contraction hierarchy on ride time: preprocessing time and shortcuts, and
+// query latency against dijkstraOptimal (fare first) and plain Dijkstra on
+// stations, the Fastest objective without a hierarchy. The hierarchy must
+// agree with the latter on every travel time.
+static void benchContraction(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %10s %8s %10s %16s %16s %12s\n", "network", "stations", "build_ms", "rounds", "shortcuts",
+           "dijkstra_ms", "station_dij_ms", "ch_ms");
+    auto report = [&](const string& name, TramRouteFinder& finder) {
+        auto pairs = randomPairs(finder.stationIds(), 500, 17);
+        RouteOptions cheapest, fastest;
+        fastest.objective = RouteObjective::Fastest;
+
+        double dijkstraMs = 0, stationMs = 0, chMs = 0;
+        vector<int> times;
+        for (auto [a, b] : pairs) {
+            dijkstraMs += finder.findRoute(a, b, cheapest).stats.elapsedMs;
+            RouteResult plain = finder.findRoute(a, b, fastest);
+            stationMs += plain.stats.elapsedMs;
+            times.push_back(plain.optimalRoute.totalTime);
+        }
+
+        auto build = finder.buildContractionHierarchy(threads);
+        for (size_t i = 0; i < pairs.size(); i++) {
+            RouteResult result = finder.findRoute(pairs[i].first, pairs[i].second, fastest);
+            chMs += result.stats.elapsedMs;
+            if (result.optimalRoute.totalTime != times[i]) {
+                fprintf(stderr, "contraction hierarchy disagrees for %lld -> %lld\n", pairs[i].first, pairs[i].second);
+                exit(1);
+            }
+        }
+        printf("%8s %8zu %10.1f %8zu %10zu %16.4f %16.4f %12.4f\n", name.c_str(), finder.stationIds().size(), build.elapsedMs,
+               build.rounds, build.shortcuts, dijkstraMs / pairs.size(), stationMs / pairs.size(), chMs / pairs.size());
+    };
+
+    string stopTimes = readFileContent("gtfs/stop_times.txt");
+    if (!stopTimes.empty()) {
+        TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimes);
+        report("gtfs", finder);
+    }
+    for (int size : sizes) {
+        for (string shape : {"grid", "radial"}) {
+            SyntheticNetwork net = shape == "grid" ? gridNetworkOfSize(size) : radialNetworkOfSize(size);
+            TramRouteFinder finder = buildFinder(net);
+            report(shape, finder);
+        }
+    }
+}
+
+// Written by the timed loop of benchHubLabels so its queries are not elided
+static volatile long long hubLabelSink;
+
+// Build time, label size and storage against the N x N travel matrix, and
+// query latency of the labels against the contraction hierarchy query they
+// come from; both must give the same time for every sampled pair.
+static void benchHubLabels(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %10s %10s %10s %12s %12s %12s %12s\n", "network", "stations", "ch_ms", "labels_ms", "avg_label",
+           "label_MB", "matrix_MB", "ch_query_us", "hl_query_ns");
+    auto report = [&](const string& name, TramRouteFinder& finder) {
+        auto started = chrono::steady_clock::now();
+        finder.buildContractionHierarchy(threads);
+        double chMs = msSince(started);
+        const ContractionHierarchy& ch = finder.contractionHierarchy();
+
+        HubLabels labels;
+        started = chrono::steady_clock::now();
+        labels.build(ch, threads);
+        double labelsMs = msSince(started);
+
+        size_t n = ch.nodeCount();
+        mt19937 rng(19);
+        vector<pair<int, int>> pairs(1000);
+        for (auto& [s, t] : pairs) s = rng() % n, t = rng() % n;
+
+        vector<int> path;
+        started = chrono::steady_clock::now();
+        for (auto [s, t] : pairs) {
+            int expected = ch.query(s, t, path);
+            if (labels.query(s, t) != (expected == ContractionHierarchy::UNREACHABLE ? HubLabels::UNREACHABLE : expected)) {
+                fprintf(stderr, "hub labels disagree for %d -> %d\n", s, t);
+                exit(1);
+            }
+        }
+        double chUs = msSince(started) * 1000 / pairs.size();
+
+        const int rounds = 2000;
+        long long checksum = 0;
+        started = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (auto [s, t] : pairs) checksum += labels.query(s, t);
+        double hlNs = msSince(started) * 1e6 / ((double)rounds * pairs.size());
+        hubLabelSink = checksum;
+
+        printf("%8s %8zu %10.1f %10.1f %10.1f %12.2f %12.2f %12.2f %12.1f\n", name.c_str(), n, chMs, labelsMs,
+               (double)labels.entryCount() / n, labels.bytes() / 1e6, n * n * 2 * sizeof(int32_t) / 1e6, chUs, hlNs);
+    };
+
+    string stopTimes = readFileContent("gtfs/stop_times.txt");
+    if (!stopTimes.empty()) {
+        TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimes);
+        report("gtfs", finder);
+    }
+    for (int size : sizes) {
+        for (string shape : {"grid", "radial"}) {
+            SyntheticNetwork net = shape == "grid" ? gridNetworkOfSize(size) : radialNetworkOfSize(size);
+            TramRouteFinder finder = buildFinder(net);
+            report(shape, finder);
+        }
+    }
+}
+
+// Transfer patterns against per-pair route JSON: build time, file size next
+// to the all_routes.json size extrapolated from sampled routes, and query
+// latency next to findRoute. Pattern routes must equal findRoute's.
+static void benchPatterns(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %10s %12s %14s %12s %12s\n", "network", "stations", "build_ms", "patterns_MB", "json_MB(est)",
+           "pattern_ms", "findRoute_ms");
+    for (int size : sizes) {
+        for (string shape : {"grid", "radial"}) {
+            SyntheticNetwork net = shape == "grid" ? gridNetworkOfSize(size) : radialNetworkOfSize(size);
+            TramRouteFinder finder = buildFinder(net);
+            auto started = chrono::steady_clock::now();
+            TransferPatterns patterns = finder.buildTransferPatterns(threads);
+            double buildMs = msSince(started);
+            size_t bytes = patterns.serialize().size();
+
+            auto pairs = randomPairs(finder.stationIds(), 200, 23);
+            double patternMs = 0, routeMs = 0, jsonBytes = 0;
+            for (auto [a, b] : pairs) {
+                started = chrono::steady_clock::now();
+                string fromPatterns = finder.resultToJson(finder.findPatternRoute(a, b, patterns));
+                patternMs += msSince(started);
+                started = chrono::steady_clock::now();
+                string fromSearch = finder.resultToJson(finder.findRoute(a, b));
+                routeMs += msSince(started);
+                if (fromPatterns != fromSearch) {
+                    fprintf(stderr, "transfer pattern route differs for %lld -> %lld\n", a, b);
+                    exit(1);
+                }
+                jsonBytes += fromSearch.size();
+            }
+            size_t n = net.stationCount();
+            printf("%8s %8zu %10.1f %12.3f %14.1f %12.3f %12.3f\n", shape.c_str(), n, buildMs, bytes / 1e6,
+                   jsonBytes / pairs.size() * n * (n - 1) / 1e6, patternMs / pairs.size(), routeMs / pairs.size());
+        }
+    }
+}
+
+// Segment route store against per-pair route JSON on gtfs/ (when run from
+// the repository root) and a generated network: build time, sizes, share
+// of routes kept as the reverse of the other direction, rides that needed
+// a station-list fallback, raw segment lookup cost, and full route lookup
+// with JSON next to findRoute. Stored routes must equal findRoute's.
+static void benchStore(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %10s %12s %14s %8s %9s %10s %12s %12s %12s\n", "network", "stations", "build_ms", "store_KB", "json_KB",
+           "ratio", "mirrored", "fallbacks", "lookup_us", "stored_ms", "findRoute_ms");
+    string file = (filesystem::temp_directory_path() / "routes_bench.bin").string();
+    auto report = [&](const string& name, TramRouteFinder& finder) {
+        auto started = chrono::steady_clock::now();
+        string bytes = finder.buildRouteStore(threads);
+        double buildMs = msSince(started);
+        ofstream(file, ios::binary).write(bytes.data(), bytes.size());
+        RouteStore store;
+        store.open(file);
+
+        vector<long long> ids = finder.stationIds();
+        size_t n = ids.size(), fallbacks = 0, lookups = 0, mirrored = 0;
+        vector<StoredLeg> legs;
+        started = chrono::steady_clock::now();
+        for (size_t s = 0; s < n; s++)
+            for (size_t t = 0; t < n; t++, lookups++)
+                if (store.route(s, t, legs))
+                    for (auto& leg : legs) fallbacks += leg.trip < 0;
+        double lookupUs = msSince(started) * 1000 / lookups;
+        for (size_t s = 0; s < n; s++)
+            for (size_t t = 0; t < s; t++) mirrored += store.mirrored(s, t);
+
+        auto pairs = randomPairs(ids, 200, 29);
+        double storedMs = 0, routeMs = 0, jsonBytes = 0;
+        for (auto [a, b] : pairs) {
+            started = chrono::steady_clock::now();
+            string fromStore = finder.resultToJson(finder.findStoredRoute(a, b, store));
+            storedMs += msSince(started);
+            started = chrono::steady_clock::now();
+            string fromSearch = finder.resultToJson(finder.findRoute(a, b));
+            routeMs += msSince(started);
+            if (fromStore != fromSearch) {
+                fprintf(stderr, "stored route differs for %lld -> %lld\n", a, b);
+                exit(1);
+            }
+            jsonBytes += fromSearch.size();
+        }
+        double json = jsonBytes / pairs.size() * n * (n - 1);
+        printf("%8s %8zu %10.0f %12.1f %14.1f %7.0fx %8.1f%% %10zu %12.3f %12.3f %12.3f\n", name.c_str(), n, buildMs,
+               bytes.size() / 1e3, json / 1e3, json / bytes.size(), 200.0 * mirrored / max<size_t>(n * (n - 1), 1), fallbacks,
+               lookupUs, storedMs / pairs.size(), routeMs / pairs.size());
+    };
+
+    string stopTimes = readFileContent("gtfs/stop_times.txt");
+    if (!stopTimes.empty()) {
+        TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimes);
+        report("gtfs", finder);
+    }
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        TramRouteFinder finder = buildFinder(net);
+        report("grid", finder);
+    }
+    filesystem::remove(file);
+}
+
+// Tiered precomputed lookups (see TieredRoutes) over the route store of a
+// generated network, on a Zipf-skewed stream of pairs, for hot tiers of
+// growing size: share of lookups the hot tier answers and p50/p99 latency
+// per tier. Halfway through, popularity is reshuffled; hot_after is the hot
+// share over the last quarter, once residency has followed the change.
+// Hot answers must equal fresh decodes.
+static void benchTiered(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %10s %8s %10s %10s %10s %12s %12s\n", "network", "stations", "hot_size", "hot_%", "hot_after",
+           "hot_p50_us", "hot_p99_us", "store_p50_us", "store_p99_us");
+    string file = (filesystem::temp_directory_path() / "routes_tiered.bin").string();
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        TramRouteFinder finder = buildFinder(net);
+        string bytes = finder.buildRouteStore(threads);
+        ofstream(file, ios::binary).write(bytes.data(), bytes.size());
+        RouteStore store;
+        store.open(file);
+        vector<long long> ids = finder.stationIds();
+        size_t n = ids.size(), pairCount = n * (n - 1);
+
+        const size_t lookups = 100000;
+        vector<double> cdf(pairCount);
+        for (size_t r = 0; r < pairCount; r++) cdf[r] = (r ? cdf[r - 1] : 0) + 1.0 / (r + 1);
+        mt19937_64 rng(37);
+        vector<uint64_t> byRank(pairCount), stream;
+        for (size_t s = 0, r = 0; s < n; s++)
+            for (size_t t = 0; t < n; t++)
+                if (s != t) byRank[r++] = s * n + t;
+        for (int phase = 0; phase < 2; phase++) {
+            shuffle(byRank.begin(), byRank.end(), rng);
+            for (size_t i = 0; i < lookups / 2; i++) {
+                double u = uniform_real_distribution<double>(0, cdf.back())(rng);
+                stream.push_back(byRank[lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()]);
+            }
+        }
+
+        for (double share : {0.0, 0.001, 0.01, 0.1}) {
+            size_t hotSize = pairCount * share;
+            TieredRoutes tiers(hotSize);
+            size_t lateHits = 0, late = 0;
+            for (size_t i = 0; i < stream.size(); i++) {
+                uint64_t key = stream[i];
+                bool decoded = false;
+                string response = tiers.lookup(key, [&]() {
+                    decoded = true;
+                    return finder.resultToJson(finder.findStoredRoute(ids[key / n], ids[key % n], store));
+                });
+                if (i >= stream.size() * 3 / 4) late++, lateHits += !decoded;
+                if (!decoded && i % 97 == 0 && response != finder.resultToJson(finder.findStoredRoute(ids[key / n], ids[key % n], store))) {
+                    fprintf(stderr, "hot answer differs for pair %llu\n", (unsigned long long)key);
+                    exit(1);
+                }
+            }
+            TieredRoutes::TierStats hot = tiers.hotStats(), cold = tiers.storeStats();
+            printf("%8s %8zu %10zu %7.1f%% %9.1f%% %10.2f %10.2f %12.2f %12.2f\n", "grid", n, hotSize,
+                   100.0 * hot.lookups / stream.size(), 100.0 * lateHits / max<size_t>(late, 1), hot.p50Us, hot.p99Us,
+                   cold.p50Us, cold.p99Us);
+        }
+    }
+    filesystem::remove(file);
+}
+
+// Incremental route store updates against a full build, on gtfs/ (when run
+// from the repository root) and a generated network: the fare of the line
+// fewest sources depend on and of the one most depend on goes up by one,
+// then the cheapest line's fare goes down by one. Updated stores must
+// answer like findRoute on the changed network.
+static void benchIncremental(const vector<int>& sizes, int threads) {
+    printf("%8s %8s %-16s %10s %12s %12s\n", "network", "stations", "change", "full_ms", "recomputed", "update_ms");
+    string file = (filesystem::temp_directory_path() / "routes_incremental.bin").string();
+    auto report = [&](const string& name, const SyntheticNetwork& net) {
+        TramRouteFinder finder = buildFinder(net);
+        RouteDependencies deps;
+        auto started = chrono::steady_clock::now();
+        string bytes = finder.buildRouteStore(threads, &deps);
+        double fullMs = msSince(started);
+        ofstream(file, ios::binary).write(bytes.data(), bytes.size());
+        RouteStore store;
+        store.open(file);
+
+        // Line indices follow name order
+        vector<string> lines;
+        for (const string& line : set<string>(net.tripNames.begin(), net.tripNames.end())) lines.push_back(line);
+        vector<int> users(lines.size(), 0);
+        for (size_t s = 0; s < deps.sourceCount(); s++)
+            for (size_t l = 0; l < lines.size(); l++) users[l] += deps.row(s)[l / 64] >> (l % 64) & 1;
+        int fewest = min_element(users.begin(), users.end()) - users.begin();
+        int most = max_element(users.begin(), users.end()) - users.begin();
+        int cheapest = 0;
+        for (size_t l = 0; l < lines.size(); l++)
+            if (net.linePrices.at(lines[l]) < net.linePrices.at(lines[cheapest])) cheapest = l;
+
+        for (auto [line, delta] : {pair<int, int>{fewest, 1}, {most, 1}, {cheapest, -1}}) {
+            SyntheticNetwork changed = net;
+            changed.linePrices[lines[line]] += delta;
+            TramRouteFinder updated = buildFinder(changed);
+            int recomputed = 0;
+            started = chrono::steady_clock::now();
+            string newBytes = updated.updateRouteStore(store, deps, threads, nullptr, &recomputed);
+            double updateMs = msSince(started);
+
+            string newFile = file + ".new";
+            ofstream(newFile, ios::binary).write(newBytes.data(), newBytes.size());
+            RouteStore newStore;
+            newStore.open(newFile);
+            vector<long long> ids = updated.stationIds();
+            for (auto [a, b] : randomPairs(ids, 200, 31)) {
+                if (updated.resultToJson(updated.findStoredRoute(a, b, newStore)) != updated.resultToJson(updated.findRoute(a, b))) {
+                    fprintf(stderr, "updated store differs for %lld -> %lld\n", a, b);
+                    exit(1);
+                }
+            }
+            filesystem::remove(newFile);
+            string change = lines[line] + (delta > 0 ? " fare +1" : " fare -1");
+            printf("%8s %8zu %-16s %10.0f %12d %12.0f\n", name.c_str(), ids.size(), change.c_str(), fullMs, recomputed, updateMs);
+        }
+    };
+
+    string stopTimes = readFileContent("gtfs/stop_times.txt");
+    if (!stopTimes.empty()) {
+        SyntheticNetwork net;
+        net.trips = trips;
+        net.tripNames = tripNames;
+        net.linePrices = linePrices;
+        net.stationNames = stationNames;
+        net.stopTimes = stopTimes;
+        report("gtfs", net);
+    }
+    for (int size : sizes) report("grid", gridNetworkOfSize(size));
+    filesystem::remove(file);
+}
+
+// Query throughput of one shared finder from 1 up to maxThreads threads
+// (doubling), each thread with its own QueryContext, on random pairs of a
+// grid network. Every thread count must give the single-thread answers.
+static void benchConcurrent(const vector<int>& sizes, int maxThreads) {
+    if (maxThreads <= 0) maxThreads = max(1u, thread::hardware_concurrency());
+    printf("%8s %8s %8s %12s %10s\n", "network", "stations", "threads", "queries/s", "speedup");
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        const TramRouteFinder finder = buildFinder(net);
+        auto pairs = randomPairs(finder.stationIds(), 2000, 41);
+
+        vector<pair<int, int>> expected;
+        double baseline = 0;
+        for (int threads = 1;; threads = min(threads * 2, maxThreads)) {
+            vector<pair<int, int>> answers(pairs.size());
+            atomic<size_t> next{0};
+            auto worker = [&]() {
+                QueryContext context(finder);
+                for (size_t i; (i = next++) < pairs.size();) {
+                    RouteResult r = context.findRoute(pairs[i].first, pairs[i].second);
+                    answers[i] = {r.optimalRoute.totalCost, r.optimalRoute.totalTime};
+                }
+            };
+            auto started = chrono::steady_clock::now();
+            vector<thread> pool;
+            for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+            for (auto& t : pool) t.join();
+            double perSecond = pairs.size() / (msSince(started) / 1000);
+
+            if (threads == 1) expected = answers, baseline = perSecond;
+            if (answers != expected) {
+                fprintf(stderr, "answers differ with %d threads\n", threads);
+                exit(1);
+            }
+            printf("%8s %8zu %8d %12.0f %9.2fx\n", "grid", finder.stationIds().size(), threads, perSecond, perSecond / baseline);
+            if (threads == maxThreads) break;
+        }
+    }
+}
+
+// The serve daemon's QueryExecutor: the same queries submitted from one
+// thread to 1, 2, 4 .. maxWorkers pinned workers (twice the cores by
+// default, to show where throughput stops growing), with the latency of a
+// query from submit to answer.
+static void benchExecutor(const vector<int>& sizes, int maxWorkers) {
+    if (maxWorkers <= 0) maxWorkers = 2 * max(1u, thread::hardware_concurrency());
+    printf("%8s %8s %8s %12s %10s %10s %10s\n", "network", "stations", "workers", "queries/s", "speedup", "p50 us",
+           "p99 us");
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        const TramRouteFinder finder = buildFinder(net);
+        auto pairs = randomPairs(finder.stationIds(), 2000, 43);
+
+        vector<pair<int, int>> expected;
+        double baseline = 0;
+        for (int workers = 1;; workers = min(workers * 2, maxWorkers)) {
+            vector<pair<int, int>> answers(pairs.size());
+            vector<uint64_t> latencies(pairs.size());
+            auto executor = make_unique<QueryExecutor<QueryContext>>(workers, true, finder);
+            auto started = chrono::steady_clock::now();
+            for (size_t i = 0; i < pairs.size(); i++) {
+                auto submitted = chrono::steady_clock::now();
+                executor->submit([&, i, submitted](QueryContext& context) {
+                    RouteResult r = context.findRoute(pairs[i].first, pairs[i].second);
+                    answers[i] = {r.optimalRoute.totalCost, r.optimalRoute.totalTime};
+                    latencies[i] = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - submitted).count();
+                });
+            }
+            executor.reset(); // runs what is still queued
+            double perSecond = pairs.size() / (msSince(started) / 1000);
+
+            if (workers == 1) expected = answers, baseline = perSecond;
+            if (answers != expected) {
+                fprintf(stderr, "answers differ with %d workers\n", workers);
+                exit(1);
+            }
+            LatencyHistogram latency;
+            for (uint64_t ns : latencies) latency.add(ns);
+            printf("%8s %8zu %8d %12.0f %9.2fx %10.0f %10.0f\n", "grid", finder.stationIds().size(), workers, perSecond,
+                   perSecond / baseline, latency.percentileUs(0.5), latency.percentileUs(0.99));
+            if (workers == maxWorkers) break;
+        }
+    }
+}
+
+// Closed-loop HTTP load on host:port: each connection, on its own thread,
+// keeps depth requests in flight (pipelined when depth > 1) and sends the
+// next as each response arrives, until it has sent its share of count
+struct HttpLoad {
+    double perSecond = 0;
+    LatencyHistogram latency;
+    size_t failed = 0; // non-200 responses and broken connections
+};
+
+// Size of the first response in input, once it is all there; else 0. The
+// body is framed by Content-Length or, as Go sends larger answers, by
+// chunked transfer encoding
+static size_t responseSize(const string& input) {
+    size_t end = input.find("\r\n\r\n");
+    if (end == string::npos) return 0;
+    size_t chunked = input.find("Transfer-Encoding: chunked");
+    if (chunked < end) {
+        // chunks are "<hex size>\r\n<data>\r\n", ending with a zero-size one
+        // and an empty trailer
+        for (size_t at = end + 4;;) {
+            size_t line = input.find("\r\n", at);
+            if (line == string::npos) return 0;
+            size_t chunk = stoul(input.substr(at, line - at), nullptr, 16);
+            at = line + 2 + chunk + 2;
+            if (input.size() < at) return 0;
+            if (chunk == 0) return at;
+        }
+    }
+    size_t at = input.find("Content-Length: ");
+    size_t size = end + 4 + (at < end ? stoul(input.substr(at + 16)) : 0);
+    return input.size() >= size ? size : 0;
+}
+
+static HttpLoad generateHttpLoad(const string& host, int port, const vector<string>& paths, int connections, int depth,
+                                 size_t count) {
+    addrinfo hints{}, *address = nullptr;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &address) != 0) {
+        fprintf(stderr, "cannot resolve %s\n", host.c_str());
+        exit(1);
+    }
+    HttpLoad load;
+    mutex merge;
+    auto client = [&](int index) {
+        LatencyHistogram latency;
+        size_t failed = 0, toSend = count / connections + (index < (int)(count % connections)), sent = 0, received = 0;
+        int fd = socket(address->ai_family, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (connect(fd, address->ai_addr, address->ai_addrlen) < 0) {
+            lock_guard<mutex> lock(merge);
+            load.failed += toSend;
+            close(fd);
+            return;
+        }
+        deque<chrono::steady_clock::time_point> inFlight;
+        string input;
+        char buffer[65536];
+        while (received < toSend) {
+            string batch;
+            for (; sent < toSend && inFlight.size() < (size_t)depth; sent++) {
+                batch += "GET " + paths[(index + sent * connections) % paths.size()] + " HTTP/1.1\r\nHost: " + host + "\r\n\r\n";
+                inFlight.push_back(chrono::steady_clock::now());
+            }
+            if (!batch.empty() && send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != (ssize_t)batch.size()) break;
+
+            size_t size;
+            while ((size = responseSize(input)) == 0) {
+                ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+                if (got <= 0) break;
+                input.append(buffer, got);
+            }
+            if (size == 0) break;
+            if (input.compare(0, 12, "HTTP/1.1 200") != 0) failed++;
+            input.erase(0, size);
+            latency.add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - inFlight.front()).count());
+            inFlight.pop_front();
+            received++;
+        }
+        close(fd);
+        lock_guard<mutex> lock(merge);
+        load.failed += failed + (toSend - received);
+        for (size_t b = 0; b < latency.counts.size(); b++) load.latency.counts[b] += latency.counts[b];
+        load.latency.total += latency.total;
+    };
+
+    auto started = chrono::steady_clock::now();
+    vector<thread> clients;
+    for (int c = 0; c < connections; c++) clients.emplace_back(client, c);
+    for (auto& t : clients) t.join();
+    load.perSecond = count / (msSince(started) / 1000);
+    freeaddrinfo(address);
+    return load;
+}
+
+// /getPath through HTTP: the native epoll server (HttpServer) in this
+// process on generated grids, answering realtime routes, and any servers
+// given with --target=host:port on gtfs station pairs, e.g. the Go server
+// (port 3000, which hands queries to `routing serve`) next to `routing
+// http` (port 3001).
+static void benchHttp(const vector<int>& sizes, int loops, const vector<string>& targets) {
+    const vector<pair<int, int>> shapes = {{1, 1}, {4, 1}, {16, 1}, {16, 8}};
+    printf("%22s %8s %11s %6s %12s %10s %10s %8s\n", "server", "stations", "connections", "depth", "requests/s", "p50 us",
+           "p99 us", "failed");
+    auto report = [&](const string& server, size_t stations, const string& host, int port, const vector<string>& paths) {
+        for (auto [connections, depth] : shapes) {
+            HttpLoad load = generateHttpLoad(host, port, paths, connections, depth, 4000);
+            printf("%22s %8zu %11d %6d %12.0f %10.0f %10.0f %8zu\n", server.c_str(), stations, connections, depth,
+                   load.perSecond, load.latency.percentileUs(0.5), load.latency.percentileUs(0.99), load.failed);
+        }
+    };
+    auto pathsOf = [](const vector<pair<long long, long long>>& pairs) {
+        vector<string> paths;
+        for (auto [start, end] : pairs)
+            paths.push_back("/getPath?start=" + to_string(start) + "&end=" + to_string(end) + "&mode=realtime");
+        return paths;
+    };
+
+    for (int size : sizes) {
+        SyntheticNetwork net = gridNetworkOfSize(size);
+        const TramRouteFinder finder = buildFinder(net);
+        auto handle = [&](const HttpRequest& request, HttpResponse& response, QueryContext& context) {
+            RouteResult r = context.findRoute(stoll(string(request.param("start"))), stoll(string(request.param("end"))));
+            response.body = finder.resultToJson(r) + "\n";
+        };
+        HttpServer<QueryContext> server(0, loops, handle, finder);
+        report("native", finder.stationIds().size(), "127.0.0.1", server.port(), pathsOf(randomPairs(finder.stationIds(), 1000, 47)));
+    }
+
+    if (targets.empty()) return;
+    TramRouteFinder gtfs(trips, tripNames, linePrices, stationNames, "");
+    vector<string> paths = pathsOf(randomPairs(gtfs.stationIds(), 1000, 53));
+    for (const string& target : targets) {
+        size_t colon = target.rfind(':');
+        report(target, gtfs.stationIds().size(), target.substr(0, colon), stoi(target.substr(colon + 1)), paths);
+    }
+}
+
+// Runs routing with args as a new process, writing input to its stdin;
+// its exit status, stdout and stderr
+static tuple<int, string, string> execRouting(const string& routing, const vector<string>& args, const string& input) {
+    int in[2], out[2], err[2];
+    if (pipe(in) != 0 || pipe(out) != 0 || pipe(err) != 0) exit(1);
+    pid_t child = fork();
+    if (child == 0) {
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        dup2(err[1], 2);
+        for (int fd : {in[0], in[1], out[0], out[1], err[0], err[1]}) close(fd);
+        vector<char*> argv = {(char*)routing.c_str()};
+        for (const string& arg : args) argv.push_back((char*)arg.c_str());
+        argv.push_back(nullptr);
+        execv(routing.c_str(), argv.data());
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    close(err[1]);
+    if (write(in[1], input.data(), input.size()) != (ssize_t)input.size()) exit(1); // inputs fit in the pipe
+    close(in[1]);
+    auto readAll = [](int fd) {
+        string bytes;
+        char buffer[1 << 16];
+        for (ssize_t got; (got = read(fd, buffer, sizeof buffer)) > 0;) bytes.append(buffer, got);
+        close(fd);
+        return bytes;
+    };
+    string stdoutBytes = readAll(out[0]), stderrBytes = readAll(err[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    return {WIFEXITED(status) ? WEXITSTATUS(status) : -1, stdoutBytes, stderrBytes};
+}
+
+// Runs the request on the routing zygote listening at socketPath (see
+// runZygote in main.cpp); its exit status, stdout and stderr
+static tuple<int, string, string> askZygote(const string& socketPath, const vector<string>& args, const string& input) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof address.sun_path - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof address) != 0) {
+        fprintf(stderr, "cannot connect to %s\n", socketPath.c_str());
+        exit(1);
+    }
+    string request;
+    for (const string& arg : args) request += (request.empty() ? "" : " ") + arg;
+    request += "\n" + input;
+    if (write(fd, request.data(), request.size()) != (ssize_t)request.size()) exit(1);
+    shutdown(fd, SHUT_WR);
+    string answer;
+    char buffer[1 << 16];
+    for (ssize_t got; (got = read(fd, buffer, sizeof buffer)) > 0;) answer.append(buffer, got);
+    close(fd);
+    int status;
+    size_t outLength, errLength, headerEnd = answer.find('\n');
+    if (headerEnd == string::npos || sscanf(answer.c_str(), "%d %zu %zu", &status, &outLength, &errLength) != 3 ||
+        answer.size() != headerEnd + 1 + outLength + errLength) {
+        fprintf(stderr, "malformed zygote answer\n");
+        exit(1);
+    }
+    return {status, answer.substr(headerEnd + 1, outLength), answer.substr(headerEnd + 1 + outLength)};
+}
+
+// Cost of one request on gtfs/ (run from the repository root, with the
+// routing binary at routing) run the way routing.go used to, by exec'ing
+// the CLI, against a child of `routing zygote` that starts with the
+// network already loaded: p50/p99 latency of route queries, isochrones
+// and 50-pair batches. Answers must be the same both ways, but for their
+// elapsedMs.
+static void benchZygote(const string& routing, int count) {
+    if (count <= 0) count = 50;
+    if (access(routing.c_str(), X_OK) != 0 || readFileContent("gtfs/stop_times.txt").empty()) {
+        fprintf(stderr, "zygote needs %s and gtfs/ in the working directory\n", routing.c_str());
+        exit(1);
+    }
+    string socketPath = (filesystem::temp_directory_path() / "tram_routing_bench.sock").string();
+    int control[2], ready[2];
+    if (pipe(control) != 0 || pipe(ready) != 0) exit(1);
+    pid_t zygote = fork();
+    if (zygote == 0) {
+        dup2(control[0], 0); // it stops once control closes
+        dup2(ready[1], 1);
+        for (int fd : {control[0], control[1], ready[0], ready[1]}) close(fd);
+        string socketArg = "--socket=" + socketPath;
+        execl(routing.c_str(), routing.c_str(), "zygote", socketArg.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    close(control[0]);
+    close(ready[1]);
+    char line[16] = {};
+    auto started = chrono::steady_clock::now();
+    if (read(ready[0], line, sizeof line - 1) <= 0 || string(line) != "ready\n") {
+        fprintf(stderr, "routing zygote did not start\n");
+        exit(1);
+    }
+    printf("zygote loaded in %.1f ms\n", msSince(started));
+
+    vector<long long> ids;
+    for (auto& station : stationNames) ids.push_back(station.first);
+    auto pairs = randomPairs(ids, count * 50, 47);
+    printf("%10s %12s %12s %12s %12s %10s\n", "request", "exec_p50_us", "exec_p99_us", "zygote_p50", "zygote_p99",
+           "speedup");
+    for (string kind : {"route", "isochrone", "batch"}) {
+        LatencyHistogram execLatency, zygoteLatency;
+        for (int i = 0; i < count; i++) {
+            auto [a, b] = pairs[i];
+            vector<string> args = {to_string(a), to_string(b), "realtime"};
+            string input;
+            if (kind == "isochrone") args = {"isochrone", to_string(a), "30", "20"};
+            if (kind == "batch") {
+                args = {"batch", "-"};
+                for (int j = 0; j < 50; j++) input += to_string(pairs[i * 50 + j].first) + " " + to_string(pairs[i * 50 + j].second) + "\n";
+            }
+            started = chrono::steady_clock::now();
+            auto fresh = execRouting(routing, args, input);
+            execLatency.add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count());
+            started = chrono::steady_clock::now();
+            auto forked = askZygote(socketPath, args, input);
+            zygoteLatency.add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count());
+            static const regex elapsed("\"elapsedMs\": *[0-9.e+-]+");
+            for (auto* answer : {&fresh, &forked}) get<1>(*answer) = regex_replace(get<1>(*answer), elapsed, "");
+            if (fresh != forked) {
+                fprintf(stderr, "zygote answer differs for %s %lld %lld\n", kind.c_str(), a, b);
+                exit(1);
+            }
+        }
+        printf("%10s %12.0f %12.0f %12.0f %12.0f %9.1fx\n", kind.c_str(), execLatency.percentileUs(0.5),
+               execLatency.percentileUs(0.99), zygoteLatency.percentileUs(0.5), zygoteLatency.percentileUs(0.99),
+               execLatency.percentileUs(0.5) / zygoteLatency.percentileUs(0.5));
+    }
+    close(control[1]);
+    waitpid(zygote, nullptr, 0);
+}
+
+int main(int argc, char* argv[]) {
+    string mode = argc > 1 ? argv[1] : "";
+    int threads = 0;
+    vector<int> sizes;
+    vector<string> targets;
+    string routing = "./cpp_binaries/routing";
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) threads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--routing=", 0) == 0) routing = arg.substr(10);
+        else if (arg.rfind("--target=", 0) == 0) targets.push_back(arg.substr(9));
+        else sizes.push_back(atoi(arg.c_str()));
+    }
+
+    if (mode == "matrix") benchMatrix(sizes.empty() ? vector<int>{1000, 5000} : sizes, threads);
+    else if (mode == "alternatives") benchAlternatives(sizes.empty() ? vector<int>{1000} : sizes);
+    else if (mode == "bidirectional") benchBidirectional(sizes.empty() ? vector<int>{1000, 5000} : sizes);
+    else if (mode == "astar") benchAStar(sizes.empty() ? vector<int>{1000, 5000} : sizes);
+    else if (mode == "alt") benchAlt(sizes.empty() ? vector<int>{1000, 5000} : sizes);
+    else if (mode == "store") benchStore(sizes.empty() ? vector<int>{2000} : sizes, threads);
+    else if (mode == "concurrent") benchConcurrent(sizes.empty() ? vector<int>{2000} : sizes, threads);
+    else if (mode == "executor") benchExecutor(sizes.empty() ? vector<int>{2000} : sizes, threads);
+    else if (mode == "http") benchHttp(sizes.empty() ? vector<int>{2000} : sizes, threads, targets);
+    else if (mode == "zygote") benchZygote(routing, sizes.empty() ? 0 : sizes[0]);
+    else if (mode == "tiered") benchTiered(sizes.empty() ? vector<int>{500} : sizes, threads);
+    else if (mode == "incremental") benchIncremental(sizes.empty() ? vector<int>{1000} : sizes, threads);
+    else if (mode == "patterns") benchPatterns(sizes.empty() ? vector<int>{1000, 5000} : sizes, threads);
+    else if (mode == "ch") benchContraction(sizes.empty() ? vector<int>{1000, 5000, 10000} : sizes, threads);
+    else if (mode == "hublabels") benchHubLabels(sizes.empty() ? vector<int>{1000, 5000, 10000} : sizes, threads);
+    else {
+        cerr << "Usage: " << argv[0] << " matrix [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " alternatives [stations...]\n"
+             << "       " << argv[0] << " bidirectional [stations...]\n"
+             << "       " << argv[0] << " astar [stations...]\n"
+             << "       " << argv[0] << " alt [stations...]\n"
+             << "       " << argv[0] << " ch [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " hublabels [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " patterns [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " store [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " incremental [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " tiered [stations...] [--threads=N]\n"
+             << "       " << argv[0] << " concurrent [stations...] [--threads=max]\n"
+             << "       " << argv[0] << " executor [stations...] [--threads=max]\n"
+             << "       " << argv[0] << " http [stations...] [--threads=N] [--target=host:port...]\n"
+             << "       " << argv[0] << " zygote [requests] [--routing=./cpp_binaries/routing]\n";
+        return 1;
+    }
+    return 0;
+}
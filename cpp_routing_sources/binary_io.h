@@ -0,0 +1,122 @@
+#pragma once
+#include <bits/stdc++.h>
+using namespace std;
+
+// Little-endian, native-layout serialization for the compiled network and
+// other binary artifacts. Readers throw runtime_error on truncated input.
+class BinaryWriter
+{
+public:
+    string bytes;
+
+    template <class T>
+    void put(const T &value)
+    {
+        static_assert(is_trivially_copyable<T>::value, "put() takes plain values");
+        bytes.append((const char *)&value, sizeof(T));
+    }
+
+    void putString(const string &value)
+    {
+        put<uint32_t>(value.size());
+        bytes += value;
+    }
+
+    template <class T>
+    void putVector(const vector<T> &values)
+    {
+        static_assert(is_trivially_copyable<T>::value, "putVector() takes plain values");
+        put<uint64_t>(values.size());
+        bytes.append((const char *)values.data(), values.size() * sizeof(T));
+    }
+};
+
+class BinaryReader
+{
+    const char *data;
+    size_t size;
+    size_t pos = 0;
+
+    void need(size_t n) const
+    {
+        if (n > size - pos) throw runtime_error("truncated binary data");
+    }
+
+public:
+    BinaryReader(const char *bytes, size_t length) : data(bytes), size(length) {}
+    explicit BinaryReader(const string &bytes) : data(bytes.data()), size(bytes.size()) {}
+
+    size_t offset() const { return pos; }
+    bool atEnd() const { return pos == size; }
+
+    template <class T>
+    T get()
+    {
+        need(sizeof(T));
+        T value;
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    string getString()
+    {
+        uint32_t length = get<uint32_t>();
+        need(length);
+        string value(data + pos, length);
+        pos += length;
+        return value;
+    }
+
+    template <class T>
+    vector<T> getVector()
+    {
+        uint64_t count = get<uint64_t>();
+        if (count > (size - pos) / sizeof(T)) throw runtime_error("truncated binary data");
+        vector<T> values(count);
+        memcpy(values.data(), data + pos, count * sizeof(T));
+        pos += count * sizeof(T);
+        return values;
+    }
+
+    void expectMagic(const char *magic)
+    {
+        size_t length = strlen(magic);
+        need(length);
+        if (memcmp(data + pos, magic, length) != 0) throw runtime_error(string("not a ") + magic + " file");
+        pos += length;
+    }
+};
+
+// Whole file as bytes, or "" if it cannot be opened
+inline string readBinaryFile(const string &filename)
+{
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) return "";
+    return string(istreambuf_iterator<char>(file), {});
+}
+
+// 64-bit FNV-1a of a byte range, stable across builds and platforms
+inline uint64_t fingerprintBytes(const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+// Replaces filename with bytes through a temporary file and a rename, so
+// readers see either the old or the new file; false on any write error
+inline bool writeFileAtomically(const string &filename, const string &bytes)
+{
+    string temporary = filename + ".tmp";
+    {
+        ofstream file(temporary, ios::binary | ios::trunc);
+        if (!file.is_open() || !file.write(bytes.data(), bytes.size()).flush()) return false;
+    }
+    if (rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
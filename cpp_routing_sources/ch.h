@@ -0,0 +1,346 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "binary_io.h"
+using namespace std;
+
+// Contraction hierarchy over an undirected graph with non-negative integer
+// weights. Nodes are contracted in rounds: each round takes an independent
+// set of nodes whose priority (edge difference plus contracted neighbours)
+// is a local minimum and contracts them in parallel, adding a shortcut
+// between two neighbours whenever a witness search finds no path at least
+// as short that avoids the node. Every node keeps the edges to the nodes
+// still left when it is contracted, all of higher rank, so one upward graph
+// serves both directions of the query.
+class ContractionHierarchy
+{
+public:
+    static constexpr int UNREACHABLE = INT_MAX;
+    static constexpr int WITNESS_SETTLE_LIMIT = 500;
+
+    struct BuildStats
+    {
+        size_t rounds = 0;
+        size_t shortcuts = 0;
+        double elapsedMs = 0;
+    };
+
+    bool empty() const { return rank.empty(); }
+    size_t nodeCount() const { return rank.size(); }
+    size_t arcCount() const { return upTo.size(); }
+    int rankOf(int v) const { return rank[v]; }
+
+    // Upward arcs of v: upTo/upWeight[upOffset[v] .. upOffset[v + 1] - 1]
+    const vector<int> &offsets() const { return upOffset; }
+    const vector<int> &targets() const { return upTo; }
+    const vector<int> &weights() const { return upWeight; }
+
+    // graph[u] lists (neighbour, weight); each edge must appear from both ends
+    BuildStats build(const vector<vector<pair<int, int>>> &graph, int threads = 0)
+    {
+        auto started = chrono::steady_clock::now();
+        if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+        int n = graph.size();
+        BuildStats stats;
+
+        adj.assign(n, {});
+        for (int u = 0; u < n; u++)
+        {
+            for (auto [v, w] : graph[u])
+            {
+                if (v != u) addArc(u, {v, w, -1});
+            }
+        }
+
+        rank.assign(n, -1);
+        vector<vector<Arc>> up(n);
+        vector<int> priority(n), contractedNeighbours(n, 0);
+        vector<char> dirty(n, 1), selected(n, 0);
+        vector<int> remaining(n);
+        iota(remaining.begin(), remaining.end(), 0);
+        vector<WitnessScratch> scratch(threads, WitnessScratch(n));
+        int nextRank = 0;
+
+        while (!remaining.empty())
+        {
+            stats.rounds++;
+            vector<int> stale;
+            for (int v : remaining)
+            {
+                if (dirty[v]) stale.push_back(v);
+            }
+            parallelFor(stale.size(), threads, [&](size_t i, int worker)
+                        {
+                            int v = stale[i];
+                            vector<Arc> shortcuts;
+                            shortcutsFor(v, selected, scratch[worker], shortcuts);
+                            priority[v] = (int)shortcuts.size() - (int)adj[v].size() + contractedNeighbours[v];
+                            dirty[v] = 0;
+                        });
+
+            // Local minima of (priority, id hash) are pairwise non-adjacent
+            auto before = [&](int a, int b)
+            {
+                return make_pair(priority[a], mix(a)) < make_pair(priority[b], mix(b));
+            };
+            vector<int> batch;
+            for (int v : remaining)
+            {
+                bool minimal = true;
+                for (const Arc &arc : adj[v]) minimal = minimal && before(v, arc.to);
+                if (minimal) batch.push_back(v);
+            }
+            for (int v : batch) selected[v] = 1;
+
+            // Witness searches avoid the whole batch, whose edges are about to go
+            vector<vector<Arc>> shortcuts(batch.size());
+            parallelFor(batch.size(), threads, [&](size_t i, int worker)
+                        { shortcutsFor(batch[i], selected, scratch[worker], shortcuts[i]); });
+
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                int v = batch[i];
+                rank[v] = nextRank++;
+                up[v] = move(adj[v]);
+                adj[v].clear();
+                for (const Arc &arc : up[v])
+                {
+                    auto &list = adj[arc.to];
+                    list.erase(find_if(list.begin(), list.end(), [&](const Arc &a) { return a.to == v; }));
+                    contractedNeighbours[arc.to]++;
+                    dirty[arc.to] = 1;
+                }
+                for (const Arc &shortcut : shortcuts[i])
+                {
+                    int u = shortcut.middle; // shortcutsFor keeps the first end here
+                    addArc(u, {shortcut.to, shortcut.weight, v});
+                    addArc(shortcut.to, {u, shortcut.weight, v});
+                    stats.shortcuts++;
+                }
+            }
+            for (int v : batch) selected[v] = 0;
+            remaining.erase(remove_if(remaining.begin(), remaining.end(), [&](int v) { return rank[v] >= 0; }), remaining.end());
+        }
+
+        upOffset.assign(n + 1, 0);
+        upTo.clear();
+        upWeight.clear();
+        upMiddle.clear();
+        for (int v = 0; v < n; v++)
+        {
+            sort(up[v].begin(), up[v].end(), [](const Arc &a, const Arc &b) { return a.to < b.to; });
+            for (const Arc &arc : up[v])
+            {
+                upTo.push_back(arc.to);
+                upWeight.push_back(arc.weight);
+                upMiddle.push_back(arc.middle);
+            }
+            upOffset[v + 1] = upTo.size();
+        }
+        adj.clear();
+        adj.shrink_to_fit();
+        stats.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return stats;
+    }
+
+    // Shortest distance from s to t, or UNREACHABLE, with the node path in
+    // path. Runs Dijkstra upward from both ends; a side stops once its
+    // queue head is no shorter than the best meeting found.
+    int query(int s, int t, vector<int> &path, long long *settled = nullptr) const
+    {
+        path.clear();
+        int n = rank.size();
+        vector<int> dist[2] = {vector<int>(n, UNREACHABLE), vector<int>(n, UNREACHABLE)};
+        vector<int> parent[2] = {vector<int>(n, -1), vector<int>(n, -1)};
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<>> pq[2];
+        dist[0][s] = 0;
+        dist[1][t] = 0;
+        pq[0].emplace(0, s);
+        pq[1].emplace(0, t);
+
+        int best = UNREACHABLE, meet = -1;
+        while (true)
+        {
+            bool open[2];
+            for (int side = 0; side < 2; side++) open[side] = !pq[side].empty() && pq[side].top().first < best;
+            if (!open[0] && !open[1]) break;
+            int side = !open[0] || (open[1] && pq[1].top().first < pq[0].top().first) ? 1 : 0;
+
+            auto [d, u] = pq[side].top();
+            pq[side].pop();
+            if (d > dist[side][u]) continue;
+            if (settled) (*settled)++;
+            if (dist[!side][u] != UNREACHABLE && d + dist[!side][u] < best)
+            {
+                best = d + dist[!side][u];
+                meet = u;
+            }
+            for (int a = upOffset[u]; a < upOffset[u + 1]; a++)
+            {
+                int v = upTo[a], nd = d + upWeight[a];
+                if (nd < dist[side][v])
+                {
+                    dist[side][v] = nd;
+                    parent[side][v] = u;
+                    pq[side].emplace(nd, v);
+                }
+            }
+        }
+        if (meet == -1) return UNREACHABLE;
+
+        vector<int> chain;
+        for (int u = meet; u != -1; u = parent[0][u]) chain.push_back(u);
+        reverse(chain.begin(), chain.end());
+        for (int u = parent[1][meet]; u != -1; u = parent[1][u]) chain.push_back(u);
+
+        path.push_back(chain[0]);
+        for (size_t i = 1; i < chain.size(); i++) unpack(chain[i - 1], chain[i], path);
+        return best;
+    }
+
+    void save(BinaryWriter &out) const
+    {
+        out.putVector(rank);
+        out.putVector(upOffset);
+        out.putVector(upTo);
+        out.putVector(upWeight);
+        out.putVector(upMiddle);
+    }
+
+    // Inverse of save(); throws runtime_error if the arrays do not fit together
+    void load(BinaryReader &in, size_t nodes)
+    {
+        rank = in.getVector<int>();
+        upOffset = in.getVector<int>();
+        upTo = in.getVector<int>();
+        upWeight = in.getVector<int>();
+        upMiddle = in.getVector<int>();
+
+        bool ok = rank.size() == nodes && upOffset.size() == nodes + 1 && upOffset[0] == 0 &&
+                  upOffset.back() == (int)upTo.size() && upWeight.size() == upTo.size() && upMiddle.size() == upTo.size();
+        for (size_t v = 0; ok && v < nodes; v++) ok = upOffset[v] <= upOffset[v + 1] && rank[v] >= 0 && rank[v] < (int)nodes;
+        for (size_t a = 0; ok && a < upTo.size(); a++)
+        {
+            ok = upTo[a] >= 0 && upTo[a] < (int)nodes && upMiddle[a] >= -1 && upMiddle[a] < (int)nodes;
+        }
+        if (!ok) throw runtime_error("corrupt contraction hierarchy");
+    }
+
+private:
+    struct Arc
+    {
+        int to;
+        int weight;
+        int middle; // contracted node a shortcut bypasses, -1 for an original edge
+    };
+
+    struct WitnessScratch
+    {
+        vector<int> dist;
+        vector<int> touched;
+        explicit WitnessScratch(int n) : dist(n, UNREACHABLE) {}
+    };
+
+    vector<vector<Arc>> adj; // remaining graph during build
+    vector<int> rank;
+    vector<int> upOffset, upTo, upWeight, upMiddle;
+
+    static uint32_t mix(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352d;
+        x ^= x >> 15;
+        return x;
+    }
+
+    // Keeps the lighter of parallel edges
+    void addArc(int u, Arc arc)
+    {
+        for (Arc &existing : adj[u])
+        {
+            if (existing.to != arc.to) continue;
+            if (arc.weight < existing.weight) existing = arc;
+            return;
+        }
+        adj[u].push_back(arc);
+    }
+
+    // Shortcuts contracting v needs, as arcs {w, weight, u} for neighbours
+    // u < w. One bounded Dijkstra per neighbour u avoids v and every blocked
+    // node; a neighbour w it does not reach within d(u, v) + d(v, w) needs
+    // the shortcut. Hitting the settle limit only costs extra shortcuts.
+    void shortcutsFor(int v, const vector<char> &blocked, WitnessScratch &ws, vector<Arc> &out) const
+    {
+        out.clear();
+        const vector<Arc> &around = adj[v];
+        int maxOut = 0;
+        for (const Arc &arc : around) maxOut = max(maxOut, arc.weight);
+
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<>> pq;
+        for (size_t i = 0; i < around.size(); i++)
+        {
+            int u = around[i].to;
+            bool needed = false;
+            for (size_t j = 0; j < around.size(); j++) needed = needed || around[j].to > u;
+            if (!needed) continue;
+
+            int limit = around[i].weight + maxOut;
+            ws.dist[u] = 0;
+            ws.touched.push_back(u);
+            pq.emplace(0, u);
+            for (int settled = 0; !pq.empty() && settled < WITNESS_SETTLE_LIMIT; settled++)
+            {
+                auto [d, x] = pq.top();
+                pq.pop();
+                if (d > ws.dist[x]) continue;
+                if (d > limit) break;
+                for (const Arc &arc : adj[x])
+                {
+                    int y = arc.to, nd = d + arc.weight;
+                    if (y == v || blocked[y] || nd >= ws.dist[y]) continue;
+                    if (ws.dist[y] == UNREACHABLE) ws.touched.push_back(y);
+                    ws.dist[y] = nd;
+                    pq.emplace(nd, y);
+                }
+            }
+
+            for (const Arc &arc : around)
+            {
+                int through = around[i].weight + arc.weight;
+                if (arc.to > u && ws.dist[arc.to] > through) out.push_back({arc.to, through, u});
+            }
+            for (int x : ws.touched) ws.dist[x] = UNREACHABLE;
+            ws.touched.clear();
+            pq = {};
+        }
+    }
+
+    // Appends the nodes after a on arc a - b, expanding shortcuts
+    void unpack(int a, int b, vector<int> &path) const
+    {
+        int low = rank[a] < rank[b] ? a : b, high = low == a ? b : a;
+        int arc = upOffset[low];
+        while (upTo[arc] != high) arc++;
+        int middle = upMiddle[arc];
+        if (middle == -1)
+        {
+            path.push_back(b);
+            return;
+        }
+        unpack(a, middle, path);
+        unpack(middle, b, path);
+    }
+
+    template <class Body>
+    static void parallelFor(size_t count, int threads, Body body)
+    {
+        atomic<size_t> next{0};
+        auto worker = [&](int id)
+        {
+            for (size_t i; (i = next++) < count;) body(i, id);
+        };
+        vector<thread> pool;
+        for (size_t t = 1; t < min<size_t>(threads, count); t++) pool.emplace_back(worker, t);
+        worker(0);
+        for (auto &t : pool) t.join();
+    }
+};
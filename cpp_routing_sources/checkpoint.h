@@ -0,0 +1,167 @@
+#pragma once
+#include <bits/stdc++.h>
+#include <unistd.h>
+#include "binary_io.h"
+using namespace std;
+
+// Completed sources of a long precompute run, appended to a sidecar file so
+// a crashed run can pick up where it stopped. The file is "TRCK", uint32
+// version, uint64 key of the work (network and output kind), then records
+// of uint32 source, uint64 length, payload and the uint64 FNV-1a of the
+// payload. A torn last record is cut off when the file is resumed. Records
+// reach the disk at least every FLUSH_SECONDS; progress (sources/s, ETA) is
+// printed on stderr at the same pace. A shard of a distributed run is the
+// same file holding the sources of its range (see read).
+class SourceCheckpoint
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr double FLUSH_SECONDS = 1.0;
+
+    // Run over total sources of the work identified by key. With resume,
+    // the records of an earlier run with the same key are kept and listed by
+    // finished(); otherwise the file starts empty. label prefixes the
+    // progress lines. Throws runtime_error if the file cannot be written.
+    SourceCheckpoint(const string &filename, uint64_t key, size_t total, bool resume, const string &label = "")
+        : filename(filename), label(label), total(total), started(chrono::steady_clock::now()), lastFlush(started)
+    {
+        bool keep = resume && load(key);
+        if (resume && !keep && filesystem::exists(filename)) cerr << "Checkpoint " << filename << " belongs to another run, starting over\n";
+        file = fopen(filename.c_str(), keep ? "ab" : "wb");
+        if (!file) throw runtime_error("cannot write " + filename);
+        if (!keep)
+        {
+            BinaryWriter header;
+            header.bytes = "TRCK";
+            header.put<uint32_t>(VERSION);
+            header.put<uint64_t>(key);
+            fwrite(header.bytes.data(), 1, header.bytes.size(), file);
+        }
+        resumed = done.size();
+        if (resumed) cerr << label << "Resuming from " << filename << ": " << resumed << " of " << total << " sources done\n";
+    }
+
+    SourceCheckpoint(const SourceCheckpoint &) = delete;
+    SourceCheckpoint &operator=(const SourceCheckpoint &) = delete;
+    ~SourceCheckpoint() { close(); }
+
+    // Payloads of the sources an earlier run finished
+    const map<int, string> &finished() const { return done; }
+
+    // Records a completed source; safe to call from several threads
+    void add(int source, const string &payload)
+    {
+        BinaryWriter record;
+        record.put<uint32_t>(source);
+        record.put<uint64_t>(payload.size());
+        record.bytes += payload;
+        record.put<uint64_t>(fingerprintBytes(payload.data(), payload.size()));
+
+        lock_guard<mutex> lock(writing);
+        if (!file) return;
+        fwrite(record.bytes.data(), 1, record.bytes.size(), file);
+        completed++;
+        auto now = chrono::steady_clock::now();
+        if (chrono::duration<double>(now - lastFlush).count() >= FLUSH_SECONDS)
+        {
+            sync();
+            lastFlush = now;
+            report(now);
+        }
+    }
+
+    // Writes outstanding records and the final progress line
+    void close()
+    {
+        lock_guard<mutex> lock(writing);
+        if (!file) return;
+        sync();
+        fclose(file);
+        file = nullptr;
+        report(chrono::steady_clock::now());
+    }
+
+    // Deletes the file once the output it was building is in place
+    void discard()
+    {
+        close();
+        filesystem::remove(filename);
+    }
+
+    // Payloads of a finished file written for key, left as it is; throws
+    // runtime_error when it is missing or belongs to other work
+    static map<int, string> read(const string &filename, uint64_t key)
+    {
+        map<int, string> records;
+        if (parse(readBinaryFile(filename), key, records) == 0) throw runtime_error(filename + " is missing or belongs to another run");
+        return records;
+    }
+
+private:
+    string filename, label;
+    size_t total;
+    size_t resumed = 0;
+    size_t completed = 0;
+    map<int, string> done;
+    FILE *file = nullptr;
+    mutex writing;
+    chrono::steady_clock::time_point started, lastFlush;
+
+    void sync()
+    {
+        fflush(file);
+        fsync(fileno(file));
+    }
+
+    void report(chrono::steady_clock::time_point now) const
+    {
+        double seconds = chrono::duration<double>(now - started).count();
+        double rate = seconds > 0 ? completed / seconds : 0;
+        size_t finishedSources = resumed + completed;
+        fprintf(stderr, "%s%zu/%zu sources", label.c_str(), finishedSources, total);
+        if (resumed) fprintf(stderr, " (%zu resumed)", resumed);
+        fprintf(stderr, ", %.1f sources/s", rate);
+        if (finishedSources < total && rate > 0) fprintf(stderr, ", ETA %.0f s", (total - finishedSources) / rate);
+        fprintf(stderr, "\n");
+    }
+
+    // Keeps the intact records of a file written for key and cuts off the
+    // rest; false when there is no such file
+    bool load(uint64_t key)
+    {
+        size_t intact = parse(readBinaryFile(filename), key, done);
+        if (intact == 0) return false;
+        filesystem::resize_file(filename, intact);
+        return true;
+    }
+
+    // Reads the records of bytes up to the first damaged one; returns the
+    // length of that intact prefix, or 0 when the header is not for key
+    static size_t parse(const string &bytes, uint64_t key, map<int, string> &records)
+    {
+        size_t intact = 0;
+        try
+        {
+            BinaryReader header(bytes);
+            header.expectMagic("TRCK");
+            if (header.get<uint32_t>() != VERSION || header.get<uint64_t>() != key) return 0;
+            intact = header.offset();
+            while (intact < bytes.size())
+            {
+                BinaryReader record(bytes.data() + intact, bytes.size() - intact);
+                uint32_t source = record.get<uint32_t>();
+                uint64_t length = record.get<uint64_t>();
+                size_t payloadAt = intact + record.offset();
+                if (length > bytes.size() - payloadAt) break;
+                BinaryReader check(bytes.data() + payloadAt + length, bytes.size() - payloadAt - length);
+                if (check.get<uint64_t>() != fingerprintBytes(bytes.data() + payloadAt, length)) break;
+                records[source] = bytes.substr(payloadAt, length);
+                intact = payloadAt + length + sizeof(uint64_t);
+            }
+        }
+        catch (const runtime_error &)
+        {
+        }
+        return intact;
+    }
+};
@@ -1,5 +1,14 @@
 #include <bits/stdc++.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "json.hpp" 
+#include "min_plus.h"
+#include "binary_io.h"
+#include "ch.h"
+#include "transfer_patterns.h"
+#include "route_store.h"
+#include "checkpoint.h"
 using json = nlohmann::json;
 using namespace std;
 
@@ -36,6 +45,42 @@ struct OptimalRoute
     int totalTime;
     vector<RouteStep> shortSteps;
     vector<RouteStep> fullSteps;
+    int transfers = 0;
+};
+
+struct SearchStats
+{
+    long long labelsCreated = 0;
+    long long labelsSettled = 0;
+    long long labelsDominated = 0;
+    long long bagOverflows = 0;
+    double elapsedMs = 0;
+};
+
+enum class RouteObjective
+{
+    Cheapest,      // lowest fare, then shortest time
+    MinTransfers,  // fewest line changes, then shortest time
+    Fastest,       // shortest time, then lowest fare along that path
+};
+
+enum class SearchEngine
+{
+    Unidirectional, // Dijkstra from the start station
+    Bidirectional,  // Dijkstra from both ends, meeting in the middle
+    AStar,          // goal-directed by stop coordinates (see loadStopCoordinates)
+    ALT,            // goal-directed by landmark distances (see buildLandmarks)
+};
+
+struct RouteOptions
+{
+    RouteObjective objective = RouteObjective::Cheapest;
+    SearchEngine engine = SearchEngine::Unidirectional;
+    bool reportStats = false; // include search stats in the result JSON
+    bool pareto = false;   // also return every (cost, time, transfers) trade-off
+    int maxBagSize = 16;   // labels kept per (station, line) state in the Pareto search
+    int alternatives = 0;  // k ranked itineraries to return next to the optimal route
+    double maxOverlap = 0.5; // share of an alternative's ride time allowed on a better-ranked one
 };
 
 struct RouteResult
@@ -44,6 +89,181 @@ struct RouteResult
     OptimalRoute optimalRoute;
     vector<DirectRoute> directRoutes;
     string error;
+    vector<OptimalRoute> paretoRoutes;
+    vector<OptimalRoute> alternativeRoutes;
+    SearchStats stats; // work of every search run for the query
+    bool hasStats = false;
+    RouteObjective objective = RouteObjective::Cheapest;
+};
+
+// Non-dominated labels of one search state, kept struct-of-arrays so the
+// dominance test compares four labels per instruction.
+struct LabelBag
+{
+    vector<int> cost;
+    vector<int> time;
+    vector<int> transfers;
+    vector<int> labels;
+
+    size_t size() const { return labels.size(); }
+
+    // True if some label in the bag is no worse than (c, t, x) on every criterion
+    bool dominates(int c, int t, int x) const
+    {
+        size_t n = labels.size(), i = 0;
+#if defined(__SSE2__)
+        const __m128i vc = _mm_set1_epi32(c), vt = _mm_set1_epi32(t), vx = _mm_set1_epi32(x);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i worse = _mm_or_si128(
+                _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)&cost[i]), vc),
+                _mm_or_si128(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)&time[i]), vt),
+                             _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)&transfers[i]), vx)));
+            if (_mm_movemask_epi8(worse) != 0xFFFF) return true;
+        }
+#endif
+        for (; i < n; i++)
+        {
+            if (cost[i] <= c && time[i] <= t && transfers[i] <= x) return true;
+        }
+        return false;
+    }
+
+    // Drop every label that (c, t, x) dominates and report their ids
+    void removeDominatedBy(int c, int t, int x, vector<int> &removed)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < labels.size(); i++)
+        {
+            if (c <= cost[i] && t <= time[i] && x <= transfers[i])
+            {
+                removed.push_back(labels[i]);
+                continue;
+            }
+            cost[kept] = cost[i];
+            time[kept] = time[i];
+            transfers[kept] = transfers[i];
+            labels[kept] = labels[i];
+            kept++;
+        }
+        cost.resize(kept);
+        time.resize(kept);
+        transfers.resize(kept);
+        labels.resize(kept);
+    }
+
+    // Empty the bag, keeping its capacity for the next query
+    void clear()
+    {
+        cost.clear();
+        time.clear();
+        transfers.clear();
+        labels.clear();
+    }
+
+    void insert(int c, int t, int x, int label)
+    {
+        cost.push_back(c);
+        time.push_back(t);
+        transfers.push_back(x);
+        labels.push_back(label);
+    }
+};
+
+// Scratch arrays of the route and isochrone searches, kept by a QueryContext
+// so one thread's queries reuse them instead of allocating per query. Only
+// fastestRoute, which runs on stations or the contraction hierarchy, keeps
+// arrays of its own.
+struct SearchBuffers
+{
+    // per-state (fare, time) labels and tree links: forward searches use
+    // label and parent, backward ones backward and next
+    vector<pair<int, int>> label;
+    vector<int> parent;
+    vector<pair<int, int>> backward;
+    vector<int> next;
+
+    // minTransfersRoute: (transfers, time, fare) per state
+    vector<tuple<int, int, int>> transferKey;
+
+    // goalDirectedOptimal: the time-to-go bound per station, -1 until read
+    vector<int> timeToGo;
+
+    // paretoSearch and budgetSearch: the labels of one query, cleared at its
+    // start, and a label bag per state; only the bags listed in
+    // touchedStates hold labels, and they are emptied after each query
+    vector<int> labelCost, labelTime, labelTransfers, labelState, labelParent;
+    vector<char> labelDead;
+    vector<LabelBag> bags;
+    vector<int> touchedStates;
+
+    // budgetSearch: the best arrival per station, set only for the stations
+    // in reachedStations and reset after each query
+    vector<pair<int, int>> best;
+    vector<int> reachedStations;
+};
+
+// Lower bound on the distance between two stations from their distances
+// to every landmark: max over landmarks of |dt[l] - dv[l]|. Rows are padded
+// to a multiple of 8 with zeros, so eight landmarks go per instruction.
+inline int landmarkBoundScalar(const int32_t *dt, const int32_t *dv, int stride)
+{
+    int bound = 0;
+    for (int l = 0; l < stride; l++) bound = max(bound, abs(dt[l] - dv[l]));
+    return bound;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) inline int landmarkBoundAvx2(const int32_t *dt, const int32_t *dv, int stride)
+{
+    __m256i best = _mm256_setzero_si256();
+    for (int l = 0; l < stride; l += 8)
+    {
+        __m256i diff = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(dt + l)), _mm256_loadu_si256((const __m256i *)(dv + l)));
+        best = _mm256_max_epi32(best, _mm256_abs_epi32(diff));
+    }
+    __m128i half = _mm_max_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+inline int landmarkBound(const int32_t *dt, const int32_t *dv, int stride)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) return landmarkBoundAvx2(dt, dv, stride);
+#endif
+    return landmarkBoundScalar(dt, dv, stride);
+}
+
+struct BatchResult
+{
+    long long startId;
+    long long targetId;
+    bool found;
+    int cost;
+    int time;
+    string error;
+};
+
+struct ReachableStation
+{
+    long long stationId;
+    string stationName;
+    int time;
+    int cost;
+    double longitude;
+    double latitude;
+};
+
+struct IsochroneResult
+{
+    bool found;
+    string error;
+    vector<ReachableStation> stations;
+    SearchStats stats;
 };
 
 struct StopTime
@@ -69,7 +289,52 @@ private:
     map<string, vector<StopTime>> tripStopTimes;
     map<pair<long long, long long>, int> stopPairTimes;
 
-    int parseTime(const string &timeStr)
+    // Integer view of lines: a search state is one (station, line) pair and
+    // the states of station u are stateOffset[u] .. stateOffset[u + 1] - 1.
+    vector<string> lineNames;
+    map<string, int> lineIds;
+    vector<int> lineFares;
+    vector<int> stateOffset;
+    vector<int> stateLine;
+    vector<int> stateStation;
+
+    // Coordinates from gtfs/stops.txt by station index, NaN when unknown
+    vector<double> stationLongitude;
+    vector<double> stationLatitude;
+
+    // Struct-of-arrays form of the coordinates for the A* heuristic, filled
+    // only when every station has coordinates: latitude and longitude in
+    // radians and cos(latitude), plus the fastest ride seen on any edge.
+    vector<double> geoLat, geoLon, geoCosLat;
+    double maxSpeedKmPerMin = 0;
+
+    // Line graph as bitsets: bit b of row a (lineWords words per row) is set
+    // when a rider on line a can change to line b at the next station.
+    int lineWords = 0;
+    vector<uint64_t> lineTransfers;
+
+    // ALT tables: landmarkDist[v * landmarkStride + l] is the shortest ride
+    // time between station v and landmark l, LANDMARK_UNREACHABLE across
+    // components. Edges run both ways with the same time, so one table bounds
+    // the distance both to and from a landmark. Rows are zero padded.
+    static constexpr int32_t LANDMARK_UNREACHABLE = 1 << 28;
+    vector<int> landmarks;
+    int landmarkStride = 0;
+    vector<int32_t> landmarkDist;
+
+    // Contraction hierarchy of the station graph on ride time, for the
+    // Fastest objective; empty until built or loaded
+    ContractionHierarchy hierarchy;
+
+    // Fingerprints of what the network was built from: the constructor's
+    // tables with the stop_times.txt content, and the stops.txt content
+    // given to loadStopCoordinates (see matchesSources)
+    uint64_t sourceFingerprint = 0;
+    uint64_t stopsFingerprint = fingerprintBytes("", 0);
+
+    TramRouteFinder() = default; // for fromCompiled
+
+    static int parseTime(const string &timeStr)
     {
         int hours = stoi(timeStr.substr(0, 2));
         int minutes = stoi(timeStr.substr(3, 2));
@@ -164,6 +429,8 @@ private:
 
         int n = allStations.size();
         adjacencyList.resize(n);
+        stationLongitude.assign(n, NAN);
+        stationLatitude.assign(n, NAN);
 
         for (int tripIdx = 0; tripIdx < trips.size(); tripIdx++)
         {
@@ -193,16 +460,333 @@ private:
                 }
             }
         }
+
+        set<string> distinctLines(tripNames.begin(), tripNames.end());
+        for (const string &line : distinctLines)
+        {
+            auto price = linePrices.find(line);
+            lineIds[line] = lineNames.size();
+            lineNames.push_back(line);
+            lineFares.push_back(price != linePrices.end() ? price->second : 0);
+        }
+
+        stateOffset.assign(n + 1, 0);
+        for (int u = 0; u < n; u++)
+        {
+            set<int> lines;
+            for (const string &line : stationLines[u]) lines.insert(lineIds.at(line));
+            stateOffset[u + 1] = stateOffset[u] + lines.size();
+            stateLine.insert(stateLine.end(), lines.begin(), lines.end());
+            stateStation.insert(stateStation.end(), lines.size(), u);
+        }
+
+        lineWords = (lineNames.size() + 63) / 64;
+        lineTransfers.assign(lineNames.size() * lineWords, 0);
+        for (int u = 0; u < n; u++)
+        {
+            for (const Edge &edge : adjacencyList[u])
+            {
+                for (int s = stateOffset[u]; s < stateOffset[u + 1]; s++)
+                {
+                    uint64_t *row = &lineTransfers[stateLine[s] * lineWords];
+                    for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                    {
+                        if (stateLine[t] != stateLine[s]) row[stateLine[t] / 64] |= 1ULL << (stateLine[t] % 64);
+                    }
+                }
+            }
+        }
+    }
+
+    vector<uint64_t> stationLineMask(int u) const
+    {
+        vector<uint64_t> mask(lineWords, 0);
+        for (int s = stateOffset[u]; s < stateOffset[u + 1]; s++)
+        {
+            mask[stateLine[s] / 64] |= 1ULL << (stateLine[s] % 64);
+        }
+        return mask;
+    }
+
+    // Breadth-first search over the line graph starting from the lines in
+    // start. Returns the number of transfers needed to reach each line (INF
+    // if unreachable) and stops at the first round that touches goal.
+    vector<int> lineBfs(const vector<uint64_t> &start, const vector<uint64_t> &goal) const
+    {
+        vector<int> level(lineNames.size(), INF);
+        vector<uint64_t> reached = start, frontier = start, next(lineWords);
+
+        for (int round = 0;; round++)
+        {
+            bool hitGoal = false, grew = false;
+            fill(next.begin(), next.end(), 0);
+            for (int w = 0; w < lineWords; w++)
+            {
+                for (uint64_t bits = frontier[w]; bits; bits &= bits - 1)
+                {
+                    int line = w * 64 + __builtin_ctzll(bits);
+                    level[line] = round;
+                    const uint64_t *row = &lineTransfers[line * lineWords];
+                    for (int x = 0; x < lineWords; x++) next[x] |= row[x];
+                }
+                hitGoal |= (frontier[w] & goal[w]) != 0;
+            }
+            if (hitGoal) break;
+
+            for (int w = 0; w < lineWords; w++)
+            {
+                next[w] &= ~reached[w];
+                reached[w] |= next[w];
+                grew |= next[w] != 0;
+            }
+            if (!grew) break;
+            swap(frontier, next);
+        }
+        return level;
+    }
+
+    static constexpr double EARTH_RADIUS_KM = 6371.0;
+
+    double haversineKm(int u, int v) const
+    {
+        double dLat = geoLat[v] - geoLat[u], dLon = geoLon[v] - geoLon[u];
+        double a = sin(dLat / 2) * sin(dLat / 2) + geoCosLat[u] * geoCosLat[v] * sin(dLon / 2) * sin(dLon / 2);
+        return 2 * EARTH_RADIUS_KM * asin(min(1.0, sqrt(a)));
+    }
+
+    // Derives the A* tables once coordinates are loaded. Without coordinates
+    // for every station, or with an edge ridden in zero minutes, no speed
+    // bound exists and A* runs with a zero heuristic.
+    void prepareGeometry()
+    {
+        int n = adjacencyList.size();
+        geoLat.clear();
+        geoLon.clear();
+        geoCosLat.clear();
+        maxSpeedKmPerMin = 0;
+        for (int u = 0; u < n; u++)
+        {
+            if (isnan(stationLatitude[u]) || isnan(stationLongitude[u])) return;
+        }
+
+        geoLat.resize(n);
+        geoLon.resize(n);
+        geoCosLat.resize(n);
+        for (int u = 0; u < n; u++)
+        {
+            geoLat[u] = stationLatitude[u] * M_PI / 180;
+            geoLon[u] = stationLongitude[u] * M_PI / 180;
+            geoCosLat[u] = cos(geoLat[u]);
+        }
+
+        for (int u = 0; u < n; u++)
+        {
+            for (const Edge &edge : adjacencyList[u])
+            {
+                double km = haversineKm(u, edge.to);
+                if (edge.travelTime <= 0 && km > 0)
+                {
+                    geoLat.clear();
+                    maxSpeedKmPerMin = 0;
+                    return;
+                }
+                if (edge.travelTime > 0) maxSpeedKmPerMin = max(maxSpeedKmPerMin, km / edge.travelTime);
+            }
+        }
+        // Slack so rounding never lets the bound exceed an edge's real time
+        maxSpeedKmPerMin *= 1 + 1e-9;
+    }
+
+    // Name of a station, empty when it has none
+    const string &stationName(long long stationId) const
+    {
+        static const string unnamed;
+        auto it = stationNames.find(stationId);
+        return it == stationNames.end() ? unnamed : it->second;
+    }
+
+    // Fare of a line, 0 when it has none
+    int linePrice(const string &line) const
+    {
+        auto it = linePrices.find(line);
+        return it == linePrices.end() ? 0 : it->second;
+    }
+
+    // State of station u on line, or -1 if the line does not serve u
+    int stateOf(int u, int line) const
+    {
+        for (int s = stateOffset[u]; s < stateOffset[u + 1]; s++)
+        {
+            if (stateLine[s] == line) return s;
+        }
+        return -1;
+    }
+
+    // Shortest ride time from station src to every station, ignoring lines.
+    // With a target the search stops once it is settled; parent, if given,
+    // receives the previous station on each shortest path.
+    vector<int> stationTimesFrom(int src, vector<int> *parent = nullptr, int target = -1, SearchStats *stats = nullptr) const
+    {
+        vector<int> dist(adjacencyList.size(), INF);
+        if (parent) parent->assign(adjacencyList.size(), -1);
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<>> pq;
+        dist[src] = 0;
+        pq.emplace(0, src);
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > dist[u]) continue;
+            if (stats) stats->labelsSettled++;
+            if (u == target) break;
+            for (const Edge &edge : adjacencyList[u])
+            {
+                if (d + edge.travelTime < dist[edge.to])
+                {
+                    dist[edge.to] = d + edge.travelTime;
+                    if (parent) (*parent)[edge.to] = u;
+                    pq.emplace(dist[edge.to], edge.to);
+                    if (stats) stats->labelsCreated++;
+                }
+            }
+        }
+        return dist;
+    }
+
+    // Cheapest way to ride a fixed sequence of stations, fewest changes on
+    // fare ties, priced as in cheapestFrom. Returns one state per station
+    // and sets fare.
+    vector<int> statesAlongPath(const vector<int> &stations, int &fare) const
+    {
+        typedef pair<int, int> Cost; // fare, transfers
+        vector<vector<Cost>> best(stations.size());
+        vector<vector<int>> from(stations.size());
+        for (size_t i = 0; i < stations.size(); i++)
+        {
+            int u = stations[i];
+            best[i].assign(stateOffset[u + 1] - stateOffset[u], {INF, INF});
+            from[i].assign(best[i].size(), -1);
+            for (int s = stateOffset[u]; s < stateOffset[u + 1]; s++)
+            {
+                Cost &cell = best[i][s - stateOffset[u]];
+                if (i == 0)
+                {
+                    cell = {lineFares[stateLine[s]], 0};
+                    continue;
+                }
+                int prev = stations[i - 1];
+                for (int p = stateOffset[prev]; p < stateOffset[prev + 1]; p++)
+                {
+                    Cost c = best[i - 1][p - stateOffset[prev]];
+                    if (stateLine[p] != stateLine[s]) c = {c.first + lineFares[stateLine[s]], c.second + 1};
+                    if (c < cell)
+                    {
+                        cell = c;
+                        from[i][s - stateOffset[u]] = p;
+                    }
+                }
+            }
+        }
+
+        int last = stations.back();
+        int s = stateOffset[last] + (min_element(best.back().begin(), best.back().end()) - best.back().begin());
+        fare = best.back()[s - stateOffset[last]].first;
+        vector<int> states(stations.size());
+        for (size_t i = stations.size(); i-- > 0;)
+        {
+            states[i] = s;
+            if (i > 0) s = from[i][s - stateOffset[stations[i]]];
+        }
+        return states;
+    }
+
+    // Ride time of the edge u - v, INF if there is none
+    int edgeTime(int u, int v) const
+    {
+        int time = INF;
+        for (const Edge &edge : adjacencyList[u])
+        {
+            if (edge.to == v) time = min(time, edge.travelTime);
+        }
+        return time;
+    }
+
+    // Direct connection on one line: the fastest ride from station from to
+    // station to through stations the line serves, as in cheapestFrom's
+    // free moves. Returns the stations, or nothing if the line cannot do it.
+    vector<int> lineLeg(int line, int from, int to, int &time) const
+    {
+        unordered_map<int, int> dist, previous;
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<>> pq;
+        dist[from] = 0;
+        pq.emplace(0, from);
+        while (!pq.empty())
+        {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > dist[u]) continue;
+            if (u == to)
+            {
+                time = d;
+                vector<int> stations;
+                for (int x = to; x != from; x = previous[x]) stations.push_back(x);
+                stations.push_back(from);
+                reverse(stations.begin(), stations.end());
+                return stations;
+            }
+            for (const Edge &edge : adjacencyList[u])
+            {
+                if (stateOf(edge.to, line) == -1) continue;
+                auto known = dist.find(edge.to);
+                if (known != dist.end() && known->second <= d + edge.travelTime) continue;
+                dist[edge.to] = d + edge.travelTime;
+                previous[edge.to] = u;
+                pq.emplace(d + edge.travelTime, edge.to);
+            }
+        }
+        return {};
+    }
+
+    // Shortest ride time, by the contraction hierarchy when one is built and
+    // plain Dijkstra on stations otherwise. The lines come afterwards from
+    // statesAlongPath, so the fare is the cheapest along that one path.
+    OptimalRoute fastestRoute(long long srcId, long long destId, SearchStats &stats) const
+    {
+        int src = stopToIdx.at(srcId);
+        int dest = stopToIdx.at(destId);
+
+        vector<int> stations;
+        int time;
+        if (!hierarchy.empty())
+        {
+            time = hierarchy.query(src, dest, stations, &stats.labelsSettled);
+            if (time == ContractionHierarchy::UNREACHABLE) return {INF, INF, {}, {}};
+        }
+        else
+        {
+            vector<int> parent;
+            time = stationTimesFrom(src, &parent, dest, &stats)[dest];
+            if (time == INF) return {INF, INF, {}, {}};
+            for (int u = dest; u != -1; u = parent[u]) stations.push_back(u);
+            reverse(stations.begin(), stations.end());
+        }
+
+        int fare;
+        vector<int> states = statesAlongPath(stations, fare);
+        OptimalRoute result = routeFromStates(states, srcId, destId);
+        result.totalCost = fare;
+        result.totalTime = time;
+        return result;
     }
     private:
 vector<RouteStep> generateShortSteps(long long srcId, long long destId, 
-                                   const vector<pair<long long, string>>& path) {
+                                   const vector<pair<long long, string>>& path) const {
     vector<RouteStep> steps;
     if (path.empty()) return steps;
 
     // Board at first station
     steps.push_back({
-        "board", path[0].first, stationNames[path[0].first], path[0].second, linePrices[path[0].second]
+        "board", path[0].first, stationName(path[0].first), path[0].second, linePrice(path[0].second)
     });
 
     string currentLine = path[0].second;
@@ -215,7 +799,7 @@ vector<RouteStep> generateShortSteps(long long srcId, long long destId,
         if (line != currentLine) {
             // Add transfer step at previous station
             steps.push_back({
-                "transfer", lastStation, stationNames[lastStation], 
+                "transfer", lastStation, stationName(lastStation), 
                 currentLine + " -> " + line, 0
             });
             currentLine = line;
@@ -223,14 +807,14 @@ vector<RouteStep> generateShortSteps(long long srcId, long long destId,
             // If this is the last station, arrive
             if (i == path.size() - 1) {
                 steps.push_back({
-                    "arrive", stationId, stationNames[stationId], currentLine, 0
+                    "arrive", stationId, stationName(stationId), currentLine, 0
                 });
             }
         } 
         // Last station on current line
         else if (i == path.size() - 1) {
             steps.push_back({
-                "arrive", stationId, stationNames[stationId], currentLine, 0
+                "arrive", stationId, stationName(stationId), currentLine, 0
             });
         }
         
@@ -240,13 +824,13 @@ vector<RouteStep> generateShortSteps(long long srcId, long long destId,
     return steps;
 }
 vector<RouteStep> generateFullSteps(long long srcId, long long destId,
-                                  const vector<pair<long long, string>>& path) {
+                                  const vector<pair<long long, string>>& path) const {
     vector<RouteStep> steps;
     if (path.empty()) return steps;
 
     // Board at first station
     steps.push_back({
-        "board", path[0].first, stationNames[path[0].first], path[0].second, linePrices[path[0].second]
+        "board", path[0].first, stationName(path[0].first), path[0].second, linePrice(path[0].second)
     });
 
     string currentLine = path[0].second;
@@ -258,7 +842,7 @@ vector<RouteStep> generateFullSteps(long long srcId, long long destId,
         if (line != currentLine) {
             // Add transfer step at previous station
             steps.push_back({
-                "transfer", path[i-1].first, stationNames[path[i-1].first], 
+                "transfer", path[i-1].first, stationName(path[i-1].first), 
                 currentLine + " -> " + line, 0
             });
             currentLine = line;
@@ -266,28 +850,28 @@ vector<RouteStep> generateFullSteps(long long srcId, long long destId,
             // If this isn't the last station, add pass for current station
             if (i < path.size() - 1) {
                 steps.push_back({
-                    "pass", stationId, stationNames[stationId], currentLine, 0
+                    "pass", stationId, stationName(stationId), currentLine, 0
                 });
             }
         } 
         // Intermediate station on same line
         else if (i < path.size() - 1) {
             steps.push_back({
-                "pass", stationId, stationNames[stationId], currentLine, 0
+                "pass", stationId, stationName(stationId), currentLine, 0
             });
         }
         
         // Last station is always arrive
         if (i == path.size() - 1) {
             steps.push_back({
-                "arrive", stationId, stationNames[stationId], currentLine, 0
+                "arrive", stationId, stationName(stationId), currentLine, 0
             });
         }
     }
 
     return steps;
 }
-    vector<DirectRoute> findDirectRoutes(long long srcId, long long destId) {
+    vector<DirectRoute> findDirectRoutes(long long srcId, long long destId) const {
         vector<DirectRoute> directRoutes;
 
         for (int i = 0; i < trips.size(); i++) {
@@ -298,7 +882,7 @@ vector<RouteStep> generateFullSteps(long long srcId, long long destId,
             auto destIt = find(trip.begin(), trip.end(), destId);
 
             if (srcIt != trip.end() && destIt != trip.end()) {
-                int cost = linePrices[line];
+                int cost = linePrice(line);
                 int totalTime = 0;
                 int srcPos = srcIt - trip.begin();
                 int destPos = destIt - trip.begin();
@@ -307,12 +891,14 @@ vector<RouteStep> generateFullSteps(long long srcId, long long destId,
                 if (srcPos < destPos) {
                     for (int j = srcPos; j < destPos; j++) {
                         auto key = make_pair(trip[j], trip[j + 1]);
-                        totalTime += (stopPairTimes.find(key) != stopPairTimes.end()) ? stopPairTimes[key] : 5;
+                        auto known = stopPairTimes.find(key);
+                        totalTime += known != stopPairTimes.end() ? known->second : 5;
                     }
                 } else {
                     for (int j = srcPos; j > destPos; j--) {
                         auto key = make_pair(trip[j], trip[j - 1]);
-                        totalTime += (stopPairTimes.find(key) != stopPairTimes.end()) ? stopPairTimes[key] : 5;
+                        auto known = stopPairTimes.find(key);
+                        totalTime += known != stopPairTimes.end() ? known->second : 5;
                     }
                 }
 
@@ -335,144 +921,1397 @@ vector<RouteStep> generateFullSteps(long long srcId, long long destId,
 
         return directRoutes;
     }
-OptimalRoute dijkstraOptimal(long long srcId, long long destId) {
-    int src = stopToIdx[srcId];
-    int dest = stopToIdx[destId];
-    int n = adjacencyList.size();
-
-    map<pair<int, string>, tuple<int, int, int, string>> state;
-    priority_queue<tuple<int, int, int, string>, vector<tuple<int, int, int, string>>, greater<>> pq;
-
-    // Initialize with all possible lines at source station
-    for (const string &line : stationLines.at(src)) {
-        int fare = linePrices[line];
-        state[{src, line}] = {fare, 0, -1, ""};
-        pq.emplace(fare, 0, src, line);
-    }
-
-    // Dijkstra's algorithm
-    while (!pq.empty()) {
-        auto [cost, time, u, currentLine] = pq.top();
-        pq.pop();
+    // One-to-all search on (fare, time) over (station, line) states; label and
+    // parent are indexed by state. Ties resolve exactly as a priority queue
+    // on (fare, time, station, line name) would, since line ids follow name order.
+    // Given a target station the search stops once every state settled from
+    // then on is worse than the best arrival there, which leaves the labels
+    // bestArrival reads for that station final.
+    void cheapestFrom(int src, vector<pair<int, int>> &label, vector<int> &parent,
+                      int target = -1, SearchStats *stats = nullptr) const
+    {
+        label.assign(stateLine.size(), {INF, INF});
+        parent.assign(stateLine.size(), -1);
+        priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<>> pq;
 
-        // Skip if we already found a better way
-        pair<int, int> currentState = {get<0>(state[{u, currentLine}]), get<1>(state[{u, currentLine}])};
-        if (state.count({u, currentLine}) && currentState < make_pair(cost, time)) {
-            continue;
+        // Initialize with all possible lines at source station
+        for (int s = stateOffset[src]; s < stateOffset[src + 1]; s++)
+        {
+            label[s] = {lineFares[stateLine[s]], 0};
+            pq.emplace(label[s].first, 0, s);
         }
 
-        // Explore neighbors
-        for (const Edge &edge : adjacencyList[u]) {
-            int v = edge.to;
-            int newTime = time + edge.travelTime;
+        pair<int, int> bestAtTarget = {INF, INF};
+        while (!pq.empty())
+        {
+            auto [cost, time, s] = pq.top();
+            pq.pop();
 
-            // Case 1: Continue on same line
-            if (find(stationLines.at(v).begin(), stationLines.at(v).end(), currentLine) != stationLines.at(v).end()) {
-                int newCost = cost;
-                pair<int, string> newState = {v, currentLine};
+            // Skip if we already found a better way
+            if (label[s] < make_pair(cost, time)) continue;
+            if (make_pair(cost, time) > bestAtTarget) break;
+            if (stateStation[s] == target) bestAtTarget = label[s];
+            if (stats) stats->labelsSettled++;
 
-                if (!state.count(newState) ||
-                    make_pair(newCost, newTime) < make_pair(get<0>(state[newState]), get<1>(state[newState]))) {
-                    state[newState] = {newCost, newTime, u, currentLine};
-                    pq.emplace(newCost, newTime, v, currentLine);
+            int line = stateLine[s];
+            for (const Edge &edge : adjacencyList[stateStation[s]])
+            {
+                int newTime = time + edge.travelTime;
+                for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                {
+                    // Stay on the same line for free, or pay the fare of the new one
+                    int newCost = stateLine[t] == line ? cost : cost + lineFares[stateLine[t]];
+                    if (make_pair(newCost, newTime) < label[t])
+                    {
+                        label[t] = {newCost, newTime};
+                        parent[t] = s;
+                        pq.emplace(newCost, newTime, t);
+                        if (stats) stats->labelsCreated++;
+                    }
                 }
             }
+        }
+    }
 
-            // Case 2: Transfer to another line
-            for (const string &newLine : stationLines.at(v)) {
-                if (newLine != currentLine) {
-                    int transferFare = linePrices[newLine];
-                    int newCost = cost + transferFare;
-                    pair<int, string> newState = {v, newLine};
+    // Best arrival state at dest after cheapestFrom, or -1 if unreachable
+    int bestArrival(int dest, const vector<pair<int, int>> &label) const
+    {
+        int best = -1;
+        for (const string &line : stationLines.at(dest))
+        {
+            int s = stateOf(dest, lineIds.at(line));
+            if (label[s].first != INF && (best == -1 || label[s] < label[best])) best = s;
+        }
+        return best;
+    }
 
-                    if (!state.count(newState) ||
-                        make_pair(newCost, newTime) < make_pair(get<0>(state[newState]), get<1>(state[newState]))) {
-                        state[newState] = {newCost, newTime, u, currentLine};
-                        pq.emplace(newCost, newTime, v, newLine);
-                    }
+    // After a full cheapestFrom tree: onlyPath[s] is 1 when the tree path to
+    // state s is the only state path of that (fare, time), i.e. no state on
+    // it has two distinct predecessors that reach it at its label. Edges are
+    // symmetric and a route pays the fare of each line it rides in either
+    // direction, so such a path walked backwards is also the only optimal
+    // one the other way.
+    vector<char> uniqueTreePaths(int src, const vector<pair<int, int>> &label, const vector<int> &parent) const
+    {
+        int states = stateLine.size();
+        vector<char> onlyPath(states, -1);
+        vector<char> singlePredecessor(states, 0);
+        for (int t = 0; t < states; t++)
+        {
+            if (label[t].first == INF) continue;
+            int line = stateLine[t];
+            int first = stateStation[t] == src ? t : -1; // the start itself
+            bool tied = false;
+            for (const Edge &edge : adjacencyList[stateStation[t]])
+            {
+                for (int q = stateOffset[edge.to]; !tied && q < stateOffset[edge.to + 1]; q++)
+                {
+                    if (label[q].first == INF) continue;
+                    int cost = stateLine[q] == line ? label[q].first : label[q].first + lineFares[line];
+                    if (make_pair(cost, label[q].second + edge.travelTime) != label[t] || q == first) continue;
+                    if (first == -1) first = q;
+                    else tied = true;
                 }
             }
+            singlePredecessor[t] = !tied;
         }
-    }
 
-    // Find best path to destination
-    int bestCost = INF, bestTime = INF;
-    string bestLine;
-    for (const string &line : stationLines.at(dest)) {
-        if (state.count({dest, line})) {
-            auto [c, t, prevStation, prevLine] = state[{dest, line}];
-            if (make_pair(c, t) < make_pair(bestCost, bestTime)) {
-                bestCost = c;
-                bestTime = t;
-                bestLine = line;
+        vector<int> chain;
+        for (int t = 0; t < states; t++)
+        {
+            for (int x = t; x != -1 && onlyPath[x] == -1; x = parent[x]) chain.push_back(x);
+            while (!chain.empty())
+            {
+                int x = chain.back();
+                chain.pop_back();
+                onlyPath[x] = singlePredecessor[x] && (parent[x] == -1 || onlyPath[parent[x]] == 1);
             }
         }
+        return onlyPath;
     }
 
-    if (bestCost == INF) return {INF, INF, {}, {}};
-
-    // Reconstruct path
-    vector<pair<long long, string>> path;
-    int currentStation = dest;
-    string currentPathLine = bestLine;
-
-    while (currentStation != -1) {
-        auto [cost, time, prevStation, prevLine] = state[{currentStation, currentPathLine}];
-        path.emplace_back(idxToStopId[currentStation], currentPathLine);
-        currentStation = prevStation;
-        currentPathLine = prevLine;
+    // Adjacent station pairs (u, v), u < v, in sorted order, each with the
+    // fastest ride between them
+    vector<pair<pair<int, int>, int>> stationPairTimes() const
+    {
+        map<pair<int, int>, int> fastest;
+        for (int u = 0; u < (int)adjacencyList.size(); u++)
+        {
+            for (const Edge &edge : adjacencyList[u])
+            {
+                if (u > edge.to) continue;
+                auto [it, added] = fastest.emplace(make_pair(u, edge.to), edge.travelTime);
+                if (!added) it->second = min(it->second, edge.travelTime);
+            }
+        }
+        return vector<pair<pair<int, int>, int>>(fastest.begin(), fastest.end());
     }
 
-    reverse(path.begin(), path.end());
-
-    // Generate steps
-    OptimalRoute result;
-    result.totalCost = bestCost;
-    result.totalTime = bestTime;
-    result.shortSteps = generateShortSteps(srcId, destId, path);
-    result.fullSteps = generateFullSteps(srcId, destId, path);
-
-    return result;
-}
-
-public:
-    TramRouteFinder(const vector<vector<long long>> &tripData,
-                    const vector<string> &tripNameData,
-                    const map<string, int> &linePriceData,
-                    const map<long long, string> &stationNameData,
-                    const string &stopTimesContent = "")
+    // Sources of a route store built on network before whose routes this
+    // network can change. A change that can only make routes worse (a
+    // higher fare, a slower or removed link, a line leaving a station, an
+    // edited trip) leaves every route that does not use it optimal and
+    // chosen by the same ties, so only the sources that depend on it are
+    // stale. A change that can make some route better (a lower fare, a
+    // faster or new link, a line reaching a new station), or other lines or
+    // trip count, makes every source stale. Stations must be the same.
+    vector<char> staleSources(const TramRouteFinder &before, const RouteDependencies &deps) const
     {
-        trips = tripData;
-        tripNames = tripNameData;
-        linePrices = linePriceData;
-        stationNames = stationNameData;
+        int n = adjacencyList.size();
+        vector<char> all(n, 1);
+        if (before.lineNames != lineNames || before.trips.size() != trips.size()) return all;
+        vector<pair<pair<int, int>, int>> oldPairs = before.stationPairTimes(), newPairs = stationPairTimes();
+        if (deps.lineWords != (lineNames.size() + 63) / 64 || deps.tripWords != (trips.size() + 63) / 64 ||
+            deps.pairWords != (oldPairs.size() + 63) / 64)
+        {
+            throw runtime_error("route dependencies do not match their network");
+        }
 
-        if (!stopTimesContent.empty()) loadStopTimes(stopTimesContent);
+        vector<uint64_t> worse(deps.rowWords(), 0);
+        auto mark = [&](size_t bit) { worse[bit / 64] |= 1ULL << (bit % 64); };
+        for (size_t line = 0; line < lineNames.size(); line++)
+        {
+            if (lineFares[line] < before.lineFares[line]) return all;
+            if (lineFares[line] > before.lineFares[line]) mark(line);
+        }
+        for (int u = 0; u < n; u++)
+        {
+            set<int> was(before.stateLine.begin() + before.stateOffset[u], before.stateLine.begin() + before.stateOffset[u + 1]);
+            set<int> now(stateLine.begin() + stateOffset[u], stateLine.begin() + stateOffset[u + 1]);
+            for (int line : now)
+                if (!was.count(line)) return all;
+            for (int line : was)
+                if (!now.count(line)) mark(line);
+        }
+        for (size_t trip = 0; trip < trips.size(); trip++)
+        {
+            if (trips[trip] != before.trips[trip] || tripNames[trip] != before.tripNames[trip]) mark(deps.lineWords * 64 + trip);
+        }
+        size_t matched = 0;
+        for (size_t i = 0; i < oldPairs.size(); i++)
+        {
+            auto it = lower_bound(newPairs.begin(), newPairs.end(), make_pair(oldPairs[i].first, INT_MIN));
+            if (it == newPairs.end() || it->first != oldPairs[i].first) mark((deps.lineWords + deps.tripWords) * 64 + i);
+            else if (it->second < oldPairs[i].second) return all;
+            else
+            {
+                matched++;
+                if (it->second > oldPairs[i].second) mark((deps.lineWords + deps.tripWords) * 64 + i);
+            }
+        }
+        if (matched < newPairs.size()) return all;
 
-        initializeData();
+        vector<char> stale(n, 0);
+        for (int src = 0; src < n; src++)
+        {
+            const uint64_t *row = deps.row(src);
+            for (size_t w = 0; !stale[src] && w < worse.size(); w++) stale[src] = (row[w] & worse[w]) != 0;
+        }
+        return stale;
     }
 
-    RouteResult findRoute(long long startStationId, long long targetStationId)
+    // Blocks of buildRouteStore for the sources marked in rebuild; the others
+    // are copied from old, built on network before, with their dependency
+    // rows renumbered to this network's station pairs, or left empty without
+    // old. Payloads, in finished and those given to checkpoint, are the block
+    // and its dependency row.
+    string routeStore(const vector<char> &rebuild, const RouteStore *old, const RouteDependencies *oldDeps, int threads,
+                      RouteDependencies *deps, const TramRouteFinder *before = nullptr,
+                      const map<int, string> *finished = nullptr, SourceCheckpoint *checkpoint = nullptr) const
     {
-        RouteResult result;
-        result.found = false;
+        if (trips.size() >= RouteStore::FALLBACK) throw runtime_error("too many trips for the route store");
+        int n = adjacencyList.size();
+        vector<vector<pair<int, int>>> stopsAt(n); // (trip, position) per station
+        for (size_t trip = 0; trip < trips.size(); trip++)
+        {
+            if (trips[trip].size() > 0xFFFF) throw runtime_error("trip too long for the route store");
+            for (size_t i = 0; i < trips[trip].size(); i++) stopsAt[stopToIdx.at(trips[trip][i])].emplace_back(trip, i);
+        }
 
-        if (stopToIdx.find(startStationId) == stopToIdx.end()) {result.error = "Start station ID " + to_string(startStationId) + " not found"; return result;}
+        auto legOf = [&](int line, const vector<int> &stations)
+        {
+            int k = stations.size() - 1;
+            for (auto [trip, board] : stopsAt[stations[0]])
+            {
+                if (tripNames[trip] != lineNames[line]) continue;
+                for (int step : {1, -1})
+                {
+                    int alight = board + step * k;
+                    if (alight < 0 || alight >= (int)trips[trip].size()) continue;
+                    bool follows = true;
+                    for (int i = 1; follows && i <= k; i++) follows = trips[trip][board + step * i] == idxToStopId.at(stations[i]);
+                    if (follows) return StoredLeg{trip, board, alight, line, {}};
+                }
+            }
+            return StoredLeg{-1, 0, 0, line, stations};
+        };
+
+        vector<pair<pair<int, int>, int>> pairs = stationPairTimes();
+        auto pairIndex = [&](pair<int, int> stations)
+        {
+            if (stations.first > stations.second) swap(stations.first, stations.second);
+            return lower_bound(pairs.begin(), pairs.end(), make_pair(stations, INT_MIN)) - pairs.begin();
+        };
+        auto setBit = [](uint64_t *words, size_t bit) { words[bit / 64] |= 1ULL << (bit % 64); };
+        vector<int> pairRenumber; // old pair index -> this network's
+        if (deps)
+        {
+            deps->network = compile();
+            deps->lineWords = (lineNames.size() + 63) / 64;
+            deps->tripWords = (trips.size() + 63) / 64;
+            deps->pairWords = (pairs.size() + 63) / 64;
+            deps->bits.assign(n * deps->rowWords(), 0);
+            if (before)
+            {
+                for (auto &[stations, time] : before->stationPairTimes())
+                {
+                    size_t i = pairIndex(stations);
+                    pairRenumber.push_back(i < pairs.size() && pairs[i].first == stations ? i : -1);
+                }
+            }
+        }
+
+        vector<string> blocks(n);
+        atomic<int> nextSource{0};
+        auto worker = [&]()
+        {
+            vector<pair<int, int>> label;
+            vector<int> parent;
+            vector<char> used;
+            for (int src; (src = nextSource++) < n;)
+            {
+                uint64_t *row = deps ? deps->row(src) : nullptr;
+                if (!rebuild[src])
+                {
+                    if (!old) continue;
+                    blocks[src] = old->block(src);
+                    if (!row) continue;
+                    const uint64_t *oldRow = oldDeps->row(src);
+                    copy(oldRow, oldRow + deps->lineWords + deps->tripWords, row);
+                    for (size_t i = 0; i < pairRenumber.size(); i++)
+                    {
+                        bool usedPair = oldRow[oldDeps->lineWords + oldDeps->tripWords + i / 64] >> (i % 64) & 1;
+                        if (usedPair && pairRenumber[i] >= 0) setBit(row + deps->lineWords + deps->tripWords, pairRenumber[i]);
+                    }
+                    continue;
+                }
+
+                auto resumed = finished ? finished->find(src) : map<int, string>::const_iterator();
+                if (finished && resumed != finished->end())
+                {
+                    BinaryReader payload(resumed->second);
+                    string block = payload.getString();
+                    vector<uint64_t> words = payload.getVector<uint64_t>();
+                    if (!row || words.size() == deps->rowWords())
+                    {
+                        blocks[src] = move(block);
+                        if (row) copy(words.begin(), words.end(), row);
+                        continue;
+                    }
+                }
+
+                cheapestFrom(src, label, parent);
+                vector<char> onlyPath = uniqueTreePaths(src, label, parent);
+                vector<vector<StoredLeg>> routes(n);
+                vector<char> mirrored(n, 0);
+                used.assign(row ? stateLine.size() : 0, 0);
+                for (int dest = 0; dest < n; dest++)
+                {
+                    int best = dest == src ? -1 : bestArrival(dest, label);
+                    for (int x = best; row && x != -1 && !used[x]; x = parent[x])
+                    {
+                        used[x] = 1;
+                        setBit(row, stateLine[x]);
+                        if (parent[x] != -1)
+                        {
+                            size_t pair = pairIndex({stateStation[parent[x]], stateStation[x]});
+                            setBit(row + deps->lineWords + deps->tripWords, pair);
+                        }
+                    }
+                    if (best != -1 && dest < src && onlyPath[best] == 1)
+                    {
+                        int ties = 0;
+                        for (int x = stateOffset[dest]; x < stateOffset[dest + 1]; x++) ties += label[x] == label[best];
+                        mirrored[dest] = ties == 1;
+                        if (mirrored[dest]) continue;
+                    }
+                    vector<int> states;
+                    for (int x = best; x != -1; x = parent[x]) states.push_back(x);
+                    reverse(states.begin(), states.end());
+
+                    vector<int> stations;
+                    for (size_t i = 0; i < states.size(); i++)
+                    {
+                        stations.push_back(stateStation[states[i]]);
+                        if (i + 1 == states.size() || stateLine[states[i + 1]] != stateLine[states[i]])
+                        {
+                            routes[dest].push_back(legOf(stateLine[states[i]], stations));
+                            if (row && routes[dest].back().trip >= 0) setBit(row + deps->lineWords, routes[dest].back().trip);
+                            stations.clear();
+                        }
+                    }
+                }
+                blocks[src] = RouteStore::encodeBlock(routes, mirrored);
+                if (checkpoint)
+                {
+                    BinaryWriter payload;
+                    payload.putString(blocks[src]);
+                    payload.putVector(row ? vector<uint64_t>(row, row + deps->rowWords()) : vector<uint64_t>());
+                    checkpoint->add(src, payload.bytes);
+                }
+            }
+        };
+
+        if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+        vector<thread> pool;
+        for (int t = 1; t < min(threads, max(n, 1)); t++) pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool) t.join();
+        string bytes = RouteStore::assemble(stationIds(), trips.size(), blocks);
+        if (deps) deps->storeFingerprint = fingerprintBytes(bytes.data(), bytes.size());
+        return bytes;
+    }
+
+    // Backward counterpart of cheapestFrom: label[s] is the cheapest (fare,
+    // time) still to pay from state s to dest, the fare of s's own line
+    // excluded, and next[s] is the following state on that path. Every edge
+    // exists in both directions, so incoming edges are read off adjacencyList.
+    void cheapestTo(int dest, vector<pair<int, int>> &label, vector<int> &next) const
+    {
+        label.assign(stateLine.size(), {INF, INF});
+        next.assign(stateLine.size(), -1);
+        priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<>> pq;
+
+        for (int t = stateOffset[dest]; t < stateOffset[dest + 1]; t++)
+        {
+            label[t] = {0, 0};
+            pq.emplace(0, 0, t);
+        }
+
+        while (!pq.empty())
+        {
+            auto [cost, time, t] = pq.top();
+            pq.pop();
+            if (label[t] < make_pair(cost, time)) continue;
+
+            int line = stateLine[t];
+            for (const Edge &edge : adjacencyList[stateStation[t]])
+            {
+                int newTime = time + edge.travelTime;
+                for (int s = stateOffset[edge.to]; s < stateOffset[edge.to + 1]; s++)
+                {
+                    int newCost = stateLine[s] == line ? cost : cost + lineFares[line];
+                    if (make_pair(newCost, newTime) < label[s])
+                    {
+                        label[s] = {newCost, newTime};
+                        next[s] = t;
+                        pq.emplace(newCost, newTime, s);
+                    }
+                }
+            }
+        }
+    }
+
+    // Route along a chain of states; fare and time are left to the caller
+    OptimalRoute routeFromStates(const vector<int> &states, long long srcId, long long destId) const
+    {
+        vector<pair<long long, string>> path;
+        OptimalRoute route;
+        route.totalCost = route.totalTime = 0;
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            path.emplace_back(idxToStopId.at(stateStation[states[i]]), lineNames[stateLine[states[i]]]);
+            if (i > 0 && stateLine[states[i]] != stateLine[states[i - 1]]) route.transfers++;
+        }
+        route.shortSteps = generateShortSteps(srcId, destId, path);
+        route.fullSteps = generateFullSteps(srcId, destId, path);
+        return route;
+    }
+
+OptimalRoute dijkstraOptimal(long long srcId, long long destId, SearchStats *stats = nullptr, SearchBuffers *buffers = nullptr) const {
+    int src = stopToIdx.at(srcId);
+    int dest = stopToIdx.at(destId);
+
+    SearchBuffers local;
+    SearchBuffers &b = buffers ? *buffers : local;
+    vector<pair<int, int>> &label = b.label;
+    vector<int> &parent = b.parent;
+    cheapestFrom(src, label, parent, dest, stats);
+
+    // Find best path to destination
+    int bestState = bestArrival(dest, label);
+    if (bestState == -1) return {INF, INF, {}, {}};
+
+    // Reconstruct path
+    vector<pair<long long, string>> path;
+    for (int s = bestState; s != -1; s = parent[s]) {
+        path.emplace_back(idxToStopId.at(stateStation[s]), lineNames[stateLine[s]]);
+    }
+
+    reverse(path.begin(), path.end());
+
+    // Generate steps
+    OptimalRoute result;
+    result.totalCost = label[bestState].first;
+    result.totalTime = label[bestState].second;
+    result.shortSteps = generateShortSteps(srcId, destId, path);
+    result.fullSteps = generateFullSteps(srcId, destId, path);
+
+    return result;
+}
+
+    // Multi-criteria label-setting search over (fare, time, transfers).
+    // Labels are settled in lexicographic order; a label is discarded when a
+    // label of the same state, or one already at the destination, is at least
+    // as good on all three criteria. maxBagSize caps the labels per state.
+    vector<OptimalRoute> paretoSearch(long long srcId, long long destId, int maxBagSize, SearchStats &stats,
+                                      SearchBuffers &buffers) const
+    {
+        auto started = chrono::steady_clock::now();
+        int src = stopToIdx.at(srcId);
+        int dest = stopToIdx.at(destId);
+
+        if (buffers.bags.size() != stateLine.size()) buffers.bags.assign(stateLine.size(), LabelBag());
+        vector<int> &labelCost = buffers.labelCost, &labelTime = buffers.labelTime;
+        vector<int> &labelTransfers = buffers.labelTransfers, &labelState = buffers.labelState;
+        vector<int> &labelParent = buffers.labelParent;
+        vector<char> &labelDead = buffers.labelDead;
+        vector<LabelBag> &bags = buffers.bags;
+        vector<int> &touched = buffers.touchedStates;
+        labelCost.clear();
+        labelTime.clear();
+        labelTransfers.clear();
+        labelState.clear();
+        labelParent.clear();
+        labelDead.clear();
+        LabelBag targetBag;
+        vector<int> removed;
+        priority_queue<tuple<int, int, int, int>, vector<tuple<int, int, int, int>>, greater<>> pq;
+
+        auto addLabel = [&](int state, int cost, int time, int transfers, int parent)
+        {
+            bool atTarget = stateStation[state] == dest;
+            if (targetBag.dominates(cost, time, transfers) || bags[state].dominates(cost, time, transfers))
+            {
+                stats.labelsDominated++;
+                return;
+            }
+
+            if (bags[state].size() == 0) touched.push_back(state);
+            removed.clear();
+            bags[state].removeDominatedBy(cost, time, transfers, removed);
+            if (atTarget) targetBag.removeDominatedBy(cost, time, transfers, removed);
+            for (int label : removed) labelDead[label] = 1;
+            stats.labelsDominated += removed.size();
+
+            if (bags[state].size() >= (size_t)maxBagSize)
+            {
+                stats.bagOverflows++;
+                return;
+            }
+
+            int id = labelCost.size();
+            labelCost.push_back(cost);
+            labelTime.push_back(time);
+            labelTransfers.push_back(transfers);
+            labelState.push_back(state);
+            labelParent.push_back(parent);
+            labelDead.push_back(0);
+            bags[state].insert(cost, time, transfers, id);
+            if (atTarget) targetBag.insert(cost, time, transfers, id);
+            pq.emplace(cost, time, transfers, id);
+            stats.labelsCreated++;
+        };
+
+        for (int s = stateOffset[src]; s < stateOffset[src + 1]; s++)
+        {
+            addLabel(s, lineFares[stateLine[s]], 0, 0, -1);
+        }
+
+        while (!pq.empty())
+        {
+            auto [cost, time, transfers, id] = pq.top();
+            pq.pop();
+            if (labelDead[id]) continue;
+            stats.labelsSettled++;
+
+            int state = labelState[id];
+            int u = stateStation[state];
+            int line = stateLine[state];
+            // Riding on past the destination never beats stopping there
+            if (u == dest) continue;
+
+            for (const Edge &edge : adjacencyList[u])
+            {
+                int v = edge.to;
+                int newTime = time + edge.travelTime;
+                for (int s = stateOffset[v]; s < stateOffset[v + 1]; s++)
+                {
+                    if (stateLine[s] == line) addLabel(s, cost, newTime, transfers, id);
+                    else addLabel(s, cost + lineFares[stateLine[s]], newTime, transfers + 1, id);
+                }
+            }
+        }
+
+        vector<OptimalRoute> routes;
+        for (int label : targetBag.labels)
+        {
+            vector<pair<long long, string>> path;
+            for (int l = label; l != -1; l = labelParent[l])
+            {
+                int state = labelState[l];
+                path.emplace_back(idxToStopId.at(stateStation[state]), lineNames[stateLine[state]]);
+            }
+            reverse(path.begin(), path.end());
+
+            OptimalRoute route;
+            route.totalCost = labelCost[label];
+            route.totalTime = labelTime[label];
+            route.transfers = labelTransfers[label];
+            route.shortSteps = generateShortSteps(srcId, destId, path);
+            route.fullSteps = generateFullSteps(srcId, destId, path);
+            routes.push_back(move(route));
+        }
+        sort(routes.begin(), routes.end(), [](const OptimalRoute &a, const OptimalRoute &b)
+             { return make_tuple(a.totalCost, a.totalTime, a.transfers) < make_tuple(b.totalCost, b.totalTime, b.transfers); });
+
+        for (int state : touched) bags[state].clear();
+        touched.clear();
+
+        stats.elapsedMs += chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return routes;
+    }
+
+    // Fewest line changes, ties broken by time and then fare. A bitset BFS
+    // over the line graph from both ends gives the minimum transfer count T
+    // and keeps only lines lying on some T-transfer journey; a Dijkstra on
+    // (transfers, time, fare) over those lines then picks the route.
+    OptimalRoute minTransfersRoute(long long srcId, long long destId, SearchBuffers &buffers) const
+    {
+        int src = stopToIdx.at(srcId);
+        int dest = stopToIdx.at(destId);
+
+        vector<uint64_t> srcLines = stationLineMask(src), destLines = stationLineMask(dest);
+        vector<int> fromSrc = lineBfs(srcLines, destLines);
+        vector<int> toDest = lineBfs(destLines, srcLines);
+
+        int minTransfers = INF;
+        for (int line = 0; line < (int)lineNames.size(); line++)
+        {
+            if (destLines[line / 64] >> (line % 64) & 1) minTransfers = min(minTransfers, fromSrc[line]);
+        }
+        if (minTransfers == INF) return {INF, INF, {}, {}};
+
+        vector<char> usable(lineNames.size());
+        for (int line = 0; line < (int)lineNames.size(); line++)
+        {
+            usable[line] = fromSrc[line] != INF && toDest[line] != INF && fromSrc[line] + toDest[line] <= minTransfers;
+        }
+
+        typedef tuple<int, int, int> Key; // transfers, time, cost
+        vector<Key> &best = buffers.transferKey;
+        vector<int> &parent = buffers.parent;
+        best.assign(stateLine.size(), Key(INF, INF, INF));
+        parent.assign(stateLine.size(), -1);
+        priority_queue<pair<Key, int>, vector<pair<Key, int>>, greater<>> pq;
+
+        for (int s = stateOffset[src]; s < stateOffset[src + 1]; s++)
+        {
+            if (!usable[stateLine[s]]) continue;
+            best[s] = Key(0, 0, lineFares[stateLine[s]]);
+            pq.emplace(best[s], s);
+        }
+
+        int target = -1;
+        while (!pq.empty())
+        {
+            auto [key, s] = pq.top();
+            pq.pop();
+            if (key != best[s]) continue;
+            int u = stateStation[s];
+            if (u == dest)
+            {
+                target = s;
+                break;
+            }
+
+            auto [transfers, time, cost] = key;
+            for (const Edge &edge : adjacencyList[u])
+            {
+                for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                {
+                    int line = stateLine[t];
+                    if (!usable[line]) continue;
+                    bool change = line != stateLine[s];
+                    if (transfers + change + toDest[line] > minTransfers) continue;
+
+                    Key next(transfers + change, time + edge.travelTime, cost + (change ? lineFares[line] : 0));
+                    if (next < best[t])
+                    {
+                        best[t] = next;
+                        parent[t] = s;
+                        pq.emplace(next, t);
+                    }
+                }
+            }
+        }
+        if (target == -1) return {INF, INF, {}, {}};
+
+        vector<int> states;
+        for (int s = target; s != -1; s = parent[s]) states.push_back(s);
+        reverse(states.begin(), states.end());
+
+        OptimalRoute result = routeFromStates(states, srcId, destId);
+        tie(result.transfers, result.totalTime, result.totalCost) = best[target];
+        return result;
+    }
+
+    // Point-to-point (fare, time) search run from both ends: forward from the
+    // source states as in cheapestFrom and backward from the destination
+    // states as in cheapestTo, each turn advancing the side with the smaller
+    // queue head. A forward label holds the fare of its own line and a
+    // backward label does not, so their sum at a state prices the whole
+    // journey through it. Labels only grow along a path, so once the two
+    // queue heads add up to the best meeting found no better one remains.
+    OptimalRoute bidirectionalOptimal(long long srcId, long long destId, SearchStats &stats, SearchBuffers &buffers) const
+    {
+        typedef pair<int, int> Cost;
+        auto plus = [](Cost a, Cost b) { return Cost(a.first + b.first, a.second + b.second); };
+        int src = stopToIdx.at(srcId);
+        int dest = stopToIdx.at(destId);
+
+        vector<Cost> &forward = buffers.label, &backward = buffers.backward;
+        vector<int> &parent = buffers.parent, &next = buffers.next;
+        forward.assign(stateLine.size(), {INF, INF});
+        backward.assign(stateLine.size(), {INF, INF});
+        parent.assign(stateLine.size(), -1);
+        next.assign(stateLine.size(), -1);
+        priority_queue<pair<Cost, int>, vector<pair<Cost, int>>, greater<>> pqForward, pqBackward;
+
+        for (int s = stateOffset[src]; s < stateOffset[src + 1]; s++)
+        {
+            forward[s] = {lineFares[stateLine[s]], 0};
+            pqForward.emplace(forward[s], s);
+        }
+        for (int s = stateOffset[dest]; s < stateOffset[dest + 1]; s++)
+        {
+            backward[s] = {0, 0};
+            pqBackward.emplace(backward[s], s);
+        }
+
+        Cost best = {INF, INF};
+        int meet = -1;
+        auto tryMeet = [&](int s)
+        {
+            if (forward[s].first == INF || backward[s].first == INF) return;
+            Cost total = plus(forward[s], backward[s]);
+            if (total < best)
+            {
+                best = total;
+                meet = s;
+            }
+        };
+
+        while (!pqForward.empty() && !pqBackward.empty())
+        {
+            Cost headForward = pqForward.top().first, headBackward = pqBackward.top().first;
+            if (plus(headForward, headBackward) >= best) break;
+
+            bool isForward = headForward <= headBackward;
+            auto &pq = isForward ? pqForward : pqBackward;
+            auto [key, s] = pq.top();
+            pq.pop();
+            if (key != (isForward ? forward[s] : backward[s])) continue;
+            stats.labelsSettled++;
+
+            int line = stateLine[s];
+            for (const Edge &edge : adjacencyList[stateStation[s]])
+            {
+                for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                {
+                    bool change = stateLine[t] != line;
+                    if (isForward)
+                    {
+                        Cost cand(key.first + (change ? lineFares[stateLine[t]] : 0), key.second + edge.travelTime);
+                        if (cand >= forward[t]) continue;
+                        forward[t] = cand;
+                        parent[t] = s;
+                        pqForward.emplace(cand, t);
+                    }
+                    else
+                    {
+                        Cost cand(key.first + (change ? lineFares[line] : 0), key.second + edge.travelTime);
+                        if (cand >= backward[t]) continue;
+                        backward[t] = cand;
+                        next[t] = s;
+                        pqBackward.emplace(cand, t);
+                    }
+                    stats.labelsCreated++;
+                    tryMeet(t);
+                }
+            }
+        }
+        if (meet == -1) return {INF, INF, {}, {}};
+
+        vector<int> states;
+        for (int s = meet; s != -1; s = parent[s]) states.push_back(s);
+        reverse(states.begin(), states.end());
+        for (int s = next[meet]; s != -1; s = next[s]) states.push_back(s);
+
+        OptimalRoute result = routeFromStates(states, srcId, destId);
+        tie(result.totalCost, result.totalTime) = best;
+        return result;
+    }
+
+    // A* on (fare, time) with a potential that is consistent on both parts:
+    // timeBound(u) never exceeds the ride time from station u to dest and
+    // drops by at most an edge's time along it, and fare to go is zero on a
+    // line serving dest, else at least the cheapest line that does. Reduced
+    // costs stay non-negative in both components, so the lexicographic
+    // order, and with it fare ties broken by time, is exactly that of
+    // dijkstraOptimal.
+    template <class TimeBound>
+    OptimalRoute goalDirectedOptimal(long long srcId, long long destId, SearchStats &stats, SearchBuffers &buffers,
+                                     TimeBound timeBound) const
+    {
+        int src = stopToIdx.at(srcId);
+        int dest = stopToIdx.at(destId);
+
+        int minDestFare = INF;
+        vector<char> servesDest(lineNames.size(), 0);
+        for (int s = stateOffset[dest]; s < stateOffset[dest + 1]; s++)
+        {
+            servesDest[stateLine[s]] = 1;
+            minDestFare = min(minDestFare, lineFares[stateLine[s]]);
+        }
+
+        vector<int> &timeToGo = buffers.timeToGo;
+        timeToGo.assign(adjacencyList.size(), -1);
+        auto potential = [&](int s)
+        {
+            int u = stateStation[s];
+            if (timeToGo[u] < 0) timeToGo[u] = timeBound(u);
+            return make_pair(servesDest[stateLine[s]] ? 0 : minDestFare, timeToGo[u]);
+        };
+
+        typedef pair<int, int> Cost;
+        vector<Cost> &label = buffers.label;
+        vector<int> &parent = buffers.parent;
+        label.assign(stateLine.size(), {INF, INF});
+        parent.assign(stateLine.size(), -1);
+        priority_queue<pair<Cost, int>, vector<pair<Cost, int>>, greater<>> pq;
+        auto push = [&](int s)
+        {
+            Cost h = potential(s);
+            pq.emplace(Cost(label[s].first + h.first, label[s].second + h.second), s);
+        };
+
+        for (int s = stateOffset[src]; s < stateOffset[src + 1]; s++)
+        {
+            label[s] = {lineFares[stateLine[s]], 0};
+            push(s);
+        }
+
+        int target = -1;
+        while (!pq.empty())
+        {
+            auto [key, s] = pq.top();
+            pq.pop();
+            Cost h = potential(s);
+            if (key != Cost(label[s].first + h.first, label[s].second + h.second)) continue;
+            stats.labelsSettled++;
+            if (stateStation[s] == dest)
+            {
+                target = s;
+                break;
+            }
+
+            auto [cost, time] = label[s];
+            for (const Edge &edge : adjacencyList[stateStation[s]])
+            {
+                for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                {
+                    Cost cand(stateLine[t] == stateLine[s] ? cost : cost + lineFares[stateLine[t]], time + edge.travelTime);
+                    if (cand >= label[t]) continue;
+                    label[t] = cand;
+                    parent[t] = s;
+                    push(t);
+                    stats.labelsCreated++;
+                }
+            }
+        }
+        if (target == -1) return {INF, INF, {}, {}};
+
+        vector<int> states;
+        for (int s = target; s != -1; s = parent[s]) states.push_back(s);
+        reverse(states.begin(), states.end());
+
+        OptimalRoute result = routeFromStates(states, srcId, destId);
+        tie(result.totalCost, result.totalTime) = label[target];
+        return result;
+    }
+
+    // Time to go is the great-circle distance to dest over the fastest
+    // speed of any edge, or zero without coordinates
+    OptimalRoute astarOptimal(long long srcId, long long destId, SearchStats &stats, SearchBuffers &buffers) const
+    {
+        int dest = stopToIdx.at(destId);
+        bool geometric = !geoLat.empty() && maxSpeedKmPerMin > 0;
+        return goalDirectedOptimal(srcId, destId, stats, buffers, [&](int u)
+                                   { return geometric ? (int)floor(haversineKm(u, dest) / maxSpeedKmPerMin) : 0; });
+    }
+
+    // Time to go is the landmark bound of landmarkBound; by the triangle
+    // inequality it is at most the ride time and consistent along edges.
+    // Without landmarks (see buildLandmarks) the bound is zero.
+    OptimalRoute altOptimal(long long srcId, long long destId, SearchStats &stats, SearchBuffers &buffers) const
+    {
+        if (landmarks.empty()) return goalDirectedOptimal(srcId, destId, stats, buffers, [](int) { return 0; });
+        const int32_t *dt = &landmarkDist[(size_t)stopToIdx.at(destId) * landmarkStride];
+        return goalDirectedOptimal(srcId, destId, stats, buffers, [&](int u)
+                                   { return landmarkBound(dt, &landmarkDist[(size_t)u * landmarkStride], landmarkStride); });
+    }
+
+    // Up to k ranked itineraries by the via-state method: one forward tree
+    // from src and one backward tree to dest are built once, and every state
+    // x yields the candidate src -> x -> dest of cost forward[x] + backward[x].
+    // Candidates are taken in (fare, time) order and kept when they visit no
+    // station twice and share at most maxOverlap of their ride time with
+    // each route already chosen. The first route is an optimal one.
+    vector<OptimalRoute> alternativeRoutes(long long srcId, long long destId, int k, double maxOverlap,
+                                           SearchBuffers &buffers) const
+    {
+        int src = stopToIdx.at(srcId);
+        int dest = stopToIdx.at(destId);
+
+        vector<pair<int, int>> &forward = buffers.label, &backward = buffers.backward;
+        vector<int> &parent = buffers.parent, &next = buffers.next;
+        cheapestFrom(src, forward, parent);
+        cheapestTo(dest, backward, next);
+
+        vector<pair<pair<int, int>, int>> candidates;
+        for (int x = 0; x < (int)stateLine.size(); x++)
+        {
+            if (forward[x].first == INF || backward[x].first == INF) continue;
+            candidates.push_back({{forward[x].first + backward[x].first, forward[x].second + backward[x].second}, x});
+        }
+        sort(candidates.begin(), candidates.end());
+
+        // Ride time per hop, keyed by the unordered station pair
+        auto edgeTime = [&](int u, int v)
+        {
+            int best = INF;
+            for (const Edge &edge : adjacencyList[u])
+            {
+                if (edge.to == v) best = min(best, edge.travelTime);
+            }
+            return best;
+        };
+
+        vector<OptimalRoute> routes;
+        vector<map<pair<int, int>, int>> chosenEdges;
+        vector<char> onPath(adjacencyList.size(), 0);
+        for (auto &[key, via] : candidates)
+        {
+            if ((int)routes.size() >= k) break;
+
+            vector<int> states;
+            for (int s = via; s != -1; s = parent[s]) states.push_back(s);
+            reverse(states.begin(), states.end());
+            for (int s = next[via]; s != -1; s = next[s]) states.push_back(s);
+
+            bool loopless = true;
+            for (int s : states)
+            {
+                if (onPath[stateStation[s]]) loopless = false;
+                onPath[stateStation[s]] = 1;
+            }
+            for (int s : states) onPath[stateStation[s]] = 0;
+            if (!loopless) continue;
+
+            map<pair<int, int>, int> edges;
+            for (size_t i = 1; i < states.size(); i++)
+            {
+                int u = stateStation[states[i - 1]], v = stateStation[states[i]];
+                edges[minmax(u, v)] = edgeTime(u, v);
+            }
+
+            bool distinct = true;
+            for (const auto &other : chosenEdges)
+            {
+                long long shared = 0, total = 0;
+                for (auto &[edge, time] : edges)
+                {
+                    total += max(time, 1);
+                    if (other.count(edge)) shared += max(time, 1);
+                }
+                if (total > 0 && shared > maxOverlap * total) distinct = false;
+            }
+            if (!distinct) continue;
+
+            OptimalRoute route = routeFromStates(states, srcId, destId);
+            tie(route.totalCost, route.totalTime) = key;
+            routes.push_back(move(route));
+            chosenEdges.push_back(move(edges));
+        }
+        return routes;
+    }
+
+    // Every station reachable from src within maxTime minutes and maxCost
+    // fare, with the fastest (time, cost) that fits both budgets. Labels are
+    // Pareto sets over (time, cost) per state, and a label over either budget
+    // is never created, so the work depends on the budget, not the network:
+    // the per-state and per-station arrays in buffers are sized once and
+    // only the entries this query reached are read and reset.
+    IsochroneResult budgetSearch(int src, int maxTime, int maxCost, SearchBuffers &buffers) const
+    {
+        auto started = chrono::steady_clock::now();
+        IsochroneResult result;
+        result.found = true;
+
+        if (buffers.bags.size() != stateLine.size()) buffers.bags.assign(stateLine.size(), LabelBag());
+        if (buffers.best.size() != adjacencyList.size()) buffers.best.assign(adjacencyList.size(), {INF, INF});
+        vector<LabelBag> &bags = buffers.bags;
+        vector<pair<int, int>> &best = buffers.best;
+        vector<int> &touched = buffers.touchedStates;
+        vector<int> &reached = buffers.reachedStations;
+        vector<int> &labelTime = buffers.labelTime, &labelCost = buffers.labelCost, &labelState = buffers.labelState;
+        vector<char> &labelDead = buffers.labelDead;
+        labelTime.clear();
+        labelCost.clear();
+        labelState.clear();
+        labelDead.clear();
+
+        vector<int> removed;
+        priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<>> pq;
+
+        auto addLabel = [&](int state, int time, int cost)
+        {
+            if (time > maxTime || cost > maxCost) return;
+            if (bags[state].dominates(time, cost, 0))
+            {
+                result.stats.labelsDominated++;
+                return;
+            }
+            if (bags[state].size() == 0) touched.push_back(state);
+            removed.clear();
+            bags[state].removeDominatedBy(time, cost, 0, removed);
+            for (int label : removed) labelDead[label] = 1;
+            result.stats.labelsDominated += removed.size();
+
+            int id = labelTime.size();
+            labelTime.push_back(time);
+            labelCost.push_back(cost);
+            labelState.push_back(state);
+            labelDead.push_back(0);
+            bags[state].insert(time, cost, 0, id);
+            pq.emplace(time, cost, id);
+            result.stats.labelsCreated++;
+        };
+
+        for (int s = stateOffset[src]; s < stateOffset[src + 1]; s++)
+        {
+            addLabel(s, 0, lineFares[stateLine[s]]);
+        }
+
+        // Labels leave the queue in (time, cost) order, so the first one
+        // settled at a station is the fastest that fits the budget
+        best[src] = {0, 0};
+        reached.push_back(src);
+        while (!pq.empty())
+        {
+            auto [time, cost, id] = pq.top();
+            pq.pop();
+            if (labelDead[id]) continue;
+            result.stats.labelsSettled++;
+
+            int state = labelState[id];
+            int u = stateStation[state];
+            if (best[u].first == INF)
+            {
+                best[u] = {time, cost};
+                reached.push_back(u);
+            }
+
+            for (const Edge &edge : adjacencyList[u])
+            {
+                for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                {
+                    int fare = stateLine[t] == stateLine[state] ? 0 : lineFares[stateLine[t]];
+                    addLabel(t, time + edge.travelTime, cost + fare);
+                }
+            }
+        }
+
+        // in station order, as a full scan would list them; the stable sort
+        // below keeps ties in that order
+        sort(reached.begin(), reached.end());
+        for (int u : reached)
+        {
+            long long id = idxToStopId.at(u);
+            auto name = stationNames.find(id);
+            result.stations.push_back({id, name != stationNames.end() ? name->second : "",
+                                       best[u].first, best[u].second, stationLongitude[u], stationLatitude[u]});
+        }
+        stable_sort(result.stations.begin(), result.stations.end(), [](const ReachableStation &a, const ReachableStation &b)
+                    { return make_pair(a.time, a.cost) < make_pair(b.time, b.cost); });
+
+        for (int state : touched) bags[state].clear();
+        for (int u : reached) best[u] = {INF, INF};
+        touched.clear();
+        reached.clear();
+
+        result.stats.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+    static json statsToJson(const SearchStats &stats)
+    {
+        return {{"labelsCreated", stats.labelsCreated},
+                {"labelsSettled", stats.labelsSettled},
+                {"labelsDominated", stats.labelsDominated},
+                {"bagOverflows", stats.bagOverflows},
+                {"elapsedMs", stats.elapsedMs}};
+    }
+
+    static json routeToJson(const OptimalRoute &route)
+    {
+        return {{"cost", route.totalCost},
+                {"time", route.totalTime},
+                {"transfers", route.transfers},
+                {"shortSteps", stepsToJson(route.shortSteps)},
+                {"fullSteps", stepsToJson(route.fullSteps)}};
+    }
+
+    static json stepsToJson(const vector<RouteStep> &steps)
+    {
+        json j = json::array();
+        for (auto &step : steps)
+        {
+            j.push_back({{"action", step.action},
+                         {"stationId", step.stationId},
+                         {"stationName", step.stationName},
+                         {"line", step.line},
+                         {"cost", step.cost}});
+        }
+        return j;
+    }
+
+public:
+    TramRouteFinder(const vector<vector<long long>> &tripData,
+                    const vector<string> &tripNameData,
+                    const map<string, int> &linePriceData,
+                    const map<long long, string> &stationNameData,
+                    const string &stopTimesContent = "")
+    {
+        trips = tripData;
+        tripNames = tripNameData;
+        linePrices = linePriceData;
+        stationNames = stationNameData;
+
+        if (!stopTimesContent.empty()) loadStopTimes(stopTimesContent);
+        sourceFingerprint = fingerprintSources(tripData, tripNameData, linePriceData, stationNameData, stopTimesContent);
+
+        initializeData();
+    }
+
+    // Fingerprint of the constructor's arguments
+    static uint64_t fingerprintSources(const vector<vector<long long>> &tripData,
+                                       const vector<string> &tripNameData,
+                                       const map<string, int> &linePriceData,
+                                       const map<long long, string> &stationNameData,
+                                       const string &stopTimesContent)
+    {
+        BinaryWriter out;
+        out.put<uint64_t>(tripData.size());
+        for (size_t i = 0; i < tripData.size(); i++)
+        {
+            out.putString(tripNameData[i]);
+            out.putVector(tripData[i]);
+        }
+        out.put<uint64_t>(linePriceData.size());
+        for (const auto &[line, fare] : linePriceData)
+        {
+            out.putString(line);
+            out.put<int32_t>(fare);
+        }
+        out.put<uint64_t>(stationNameData.size());
+        for (const auto &[id, name] : stationNameData)
+        {
+            out.put<int64_t>(id);
+            out.putString(name);
+        }
+        out.putString(stopTimesContent);
+        return fingerprintBytes(out.bytes.data(), out.bytes.size());
+    }
+
+    // True when this network was built from these tables, stop_times.txt and
+    // stops.txt contents, so a compiled network still reflects its sources
+    bool matchesSources(const vector<vector<long long>> &tripData,
+                        const vector<string> &tripNameData,
+                        const map<string, int> &linePriceData,
+                        const map<long long, string> &stationNameData,
+                        const string &stopTimesContent,
+                        const string &stopsContent) const
+    {
+        return sourceFingerprint == fingerprintSources(tripData, tripNameData, linePriceData, stationNameData, stopTimesContent) &&
+               stopsFingerprint == fingerprintBytes(stopsContent.data(), stopsContent.size());
+    }
+
+    // Reads Longitude/Latitude per station ID from gtfs/stops.txt content
+    void loadStopCoordinates(const string &stopsContent)
+    {
+        stopsFingerprint = fingerprintBytes(stopsContent.data(), stopsContent.size());
+        istringstream ss(stopsContent);
+        string line;
+        getline(ss, line); // Skip header
+
+        while (getline(ss, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            vector<string> fields;
+            istringstream lineStream(line);
+            string field;
+            while (getline(lineStream, field, ',')) fields.push_back(field);
+            if (fields.size() < 5) continue;
+
+            try
+            {
+                auto station = stopToIdx.find(stoll(fields[0]));
+                if (station == stopToIdx.end()) continue;
+                stationLongitude[station->second] = stod(fields[3]);
+                stationLatitude[station->second] = stod(fields[4]);
+            }
+            catch (const exception &)
+            {
+                continue; // malformed row
+            }
+        }
+        prepareGeometry();
+    }
+
+    static constexpr int DEFAULT_LANDMARKS = 8;
+
+    // Picks k landmarks by farthest-point selection on ride time: first the
+    // station farthest from station 0, then each time the station farthest
+    // from every landmark chosen so far (another component counts as
+    // infinitely far). The search from each landmark fills its table column.
+    void buildLandmarks(int k)
+    {
+        int n = adjacencyList.size();
+        k = max(0, min(k, n));
+        landmarks.clear();
+        landmarkStride = (k + 7) / 8 * 8;
+        landmarkDist.assign((size_t)n * landmarkStride, 0);
+        if (k == 0) return;
+
+        vector<int> nearest = stationTimesFrom(0);
+        for (int l = 0; l < k; l++)
+        {
+            int next = max_element(nearest.begin(), nearest.end()) - nearest.begin();
+            if (l > 0 && nearest[next] == 0) break; // every station is a landmark already
+            landmarks.push_back(next);
+            vector<int> dist = stationTimesFrom(next);
+            for (int v = 0; v < n; v++)
+            {
+                landmarkDist[(size_t)v * landmarkStride + l] = dist[v] == INF ? LANDMARK_UNREACHABLE : dist[v];
+                nearest[v] = l == 0 ? dist[v] : min(nearest[v], dist[v]);
+            }
+        }
+    }
+
+    size_t landmarkCount() const { return landmarks.size(); }
+
+    // Contracts the station graph on ride time for the Fastest objective
+    ContractionHierarchy::BuildStats buildContractionHierarchy(int threads = 0)
+    {
+        vector<vector<pair<int, int>>> graph(adjacencyList.size());
+        for (size_t u = 0; u < adjacencyList.size(); u++)
+        {
+            for (const Edge &edge : adjacencyList[u]) graph[u].emplace_back(edge.to, edge.travelTime);
+        }
+        return hierarchy.build(graph, threads);
+    }
+
+    bool hasContractionHierarchy() const { return !hierarchy.empty(); }
+    const ContractionHierarchy &contractionHierarchy() const { return hierarchy; }
+
+    static constexpr uint32_t COMPILED_VERSION = 3;
+
+    // Compiled network: "TRNET", uint32 version, the two source fingerprints
+    // (see matchesSources), then the trips (name, stop ids), line fares,
+    // station names and stop-to-stop ride times the constructor takes,
+    // followed by per-station coordinates and the
+    // landmark tables, all by station index, and a uint8 flag followed by
+    // the contraction hierarchy if one was built. Loading it skips parsing
+    // stop_times.txt and stops.txt, the landmark searches and contraction.
+    string compile() const
+    {
+        BinaryWriter out;
+        out.bytes = "TRNET";
+        out.put<uint32_t>(COMPILED_VERSION);
+        out.put<uint64_t>(sourceFingerprint);
+        out.put<uint64_t>(stopsFingerprint);
+        out.put<uint64_t>(trips.size());
+        for (size_t i = 0; i < trips.size(); i++)
+        {
+            out.putString(tripNames[i]);
+            out.putVector(trips[i]);
+        }
+        out.put<uint64_t>(linePrices.size());
+        for (const auto &[line, fare] : linePrices)
+        {
+            out.putString(line);
+            out.put<int32_t>(fare);
+        }
+        out.put<uint64_t>(stationNames.size());
+        for (const auto &[id, name] : stationNames)
+        {
+            out.put<int64_t>(id);
+            out.putString(name);
+        }
+        out.put<uint64_t>(stopPairTimes.size());
+        for (const auto &[stops, minutes] : stopPairTimes)
+        {
+            out.put<int64_t>(stops.first);
+            out.put<int64_t>(stops.second);
+            out.put<int32_t>(minutes);
+        }
+        out.putVector(stationLongitude);
+        out.putVector(stationLatitude);
+        out.putVector(landmarks);
+        out.put<uint32_t>(landmarkStride);
+        out.putVector(landmarkDist);
+        out.put<uint8_t>(!hierarchy.empty());
+        if (!hierarchy.empty()) hierarchy.save(out);
+        return out.bytes;
+    }
+
+    // Inverse of compile(); throws runtime_error on malformed input
+    static TramRouteFinder fromCompiled(string_view bytes)
+    {
+        BinaryReader in(bytes.data(), bytes.size());
+        in.expectMagic("TRNET");
+        if (in.get<uint32_t>() != COMPILED_VERSION) throw runtime_error("unsupported compiled network version");
+
+        TramRouteFinder finder;
+        finder.sourceFingerprint = in.get<uint64_t>();
+        finder.stopsFingerprint = in.get<uint64_t>();
+        for (uint64_t i = 0, count = in.get<uint64_t>(); i < count; i++)
+        {
+            finder.tripNames.push_back(in.getString());
+            finder.trips.push_back(in.getVector<long long>());
+        }
+        for (uint64_t i = 0, count = in.get<uint64_t>(); i < count; i++)
+        {
+            string line = in.getString();
+            finder.linePrices[line] = in.get<int32_t>();
+        }
+        for (uint64_t i = 0, count = in.get<uint64_t>(); i < count; i++)
+        {
+            long long id = in.get<int64_t>();
+            finder.stationNames[id] = in.getString();
+        }
+        for (uint64_t i = 0, count = in.get<uint64_t>(); i < count; i++)
+        {
+            long long from = in.get<int64_t>(), to = in.get<int64_t>();
+            finder.stopPairTimes[{from, to}] = in.get<int32_t>();
+        }
+        finder.initializeData();
+
+        size_t n = finder.adjacencyList.size();
+        finder.stationLongitude = in.getVector<double>();
+        finder.stationLatitude = in.getVector<double>();
+        finder.landmarks = in.getVector<int>();
+        finder.landmarkStride = in.get<uint32_t>();
+        finder.landmarkDist = in.getVector<int32_t>();
+        if (in.get<uint8_t>()) finder.hierarchy.load(in, n);
+        bool landmarksOk = finder.landmarkStride % 8 == 0 && finder.landmarks.size() <= (size_t)finder.landmarkStride &&
+                           finder.landmarkDist.size() == n * finder.landmarkStride &&
+                           all_of(finder.landmarks.begin(), finder.landmarks.end(), [&](int l) { return l >= 0 && (size_t)l < n; });
+        if (finder.stationLongitude.size() != n || finder.stationLatitude.size() != n || !landmarksOk || !in.atEnd())
+        {
+            throw runtime_error("corrupt compiled network");
+        }
+        finder.prepareGeometry();
+        return finder;
+    }
+
+    // Isochrone query; buffers, if given, are reused by the search (see
+    // QueryContext).
+    IsochroneResult findReachable(long long startStationId, int maxTime, int maxCost, SearchBuffers *buffers = nullptr) const
+    {
+        IsochroneResult result;
+        result.found = false;
+
+        auto start = stopToIdx.find(startStationId);
+        if (start == stopToIdx.end()) {result.error = "Start station ID " + to_string(startStationId) + " not found"; return result;}
+
+        if (maxTime < 0 || maxCost < 0) {result.error = "Budgets must not be negative"; return result;}
+
+        SearchBuffers local;
+        return budgetSearch(start->second, maxTime, maxCost, buffers ? *buffers : local);
+    }
+
+    string isochroneToJson(const IsochroneResult &result) const
+    {
+        json j;
+        if (!result.found) {j["found"] = false; j["error"] = result.error; return j.dump(2);}
+
+        j["found"] = true;
+        j["stations"] = json::array();
+        for (auto &station : result.stations)
+        {
+            json st = {{"stationId", station.stationId},
+                       {"stationName", station.stationName},
+                       {"time", station.time},
+                       {"cost", station.cost}};
+            st["longitude"] = isnan(station.longitude) ? json(nullptr) : json(station.longitude);
+            st["latitude"] = isnan(station.latitude) ? json(nullptr) : json(station.latitude);
+            j["stations"].push_back(move(st));
+        }
+        j["stats"] = statsToJson(result.stats);
+        return j.dump(2);
+    }
+
+    // Route query; const, like every query method, so threads may share a
+    // finder. buffers, if given, are reused by the search (see QueryContext).
+    RouteResult findRoute(long long startStationId, long long targetStationId,
+                          const RouteOptions &options = RouteOptions(), SearchBuffers *buffers = nullptr) const
+    {
+        RouteResult result;
+        result.found = false;
+
+        if (stopToIdx.find(startStationId) == stopToIdx.end()) {result.error = "Start station ID " + to_string(startStationId) + " not found"; return result;}
 
         if (stopToIdx.find(targetStationId) == stopToIdx.end()){result.error = "Target station ID " + to_string(targetStationId) + " not found"; return result;}
 
         if (startStationId == targetStationId) {result.error = "Start and target stations are the same"; return result;}
 
+        result.objective = options.objective;
         result.directRoutes = findDirectRoutes(startStationId, targetStationId);
-        result.optimalRoute = dijkstraOptimal(startStationId, targetStationId);
+        SearchBuffers local;
+        SearchBuffers &b = buffers ? *buffers : local;
+        auto started = chrono::steady_clock::now();
+        if (options.objective == RouteObjective::MinTransfers) result.optimalRoute = minTransfersRoute(startStationId, targetStationId, b);
+        else if (options.objective == RouteObjective::Fastest) result.optimalRoute = fastestRoute(startStationId, targetStationId, result.stats);
+        else if (options.engine == SearchEngine::Bidirectional) result.optimalRoute = bidirectionalOptimal(startStationId, targetStationId, result.stats, b);
+        else if (options.engine == SearchEngine::AStar) result.optimalRoute = astarOptimal(startStationId, targetStationId, result.stats, b);
+        else if (options.engine == SearchEngine::ALT) result.optimalRoute = altOptimal(startStationId, targetStationId, result.stats, b);
+        else result.optimalRoute = dijkstraOptimal(startStationId, targetStationId, &result.stats, &b);
+        result.stats.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        result.hasStats = options.reportStats || options.pareto;
 
         if (result.optimalRoute.totalCost == INF) {result.error = "No route found between these stations"; return result;}
 
+        if (options.pareto) result.paretoRoutes = paretoSearch(startStationId, targetStationId, options.maxBagSize, result.stats, b);
+        if (options.alternatives > 0) result.alternativeRoutes = alternativeRoutes(startStationId, targetStationId, options.alternatives, options.maxOverlap, b);
+
         result.found = true;
         return result;
     }
 
-    string resultToJson(const RouteResult &result)
+    string resultToJson(const RouteResult &result) const
     {
         json j;
         if (!result.found) {j["found"] = false; j["error"] = result.error;}
@@ -484,6 +2323,7 @@ public:
             json opt;
             opt["cost"] = result.optimalRoute.totalCost;
             opt["time"] = result.optimalRoute.totalTime;
+            if (result.objective == RouteObjective::MinTransfers) opt["transfers"] = result.optimalRoute.transfers;
 
             // shortSteps
             for (auto &step : result.optimalRoute.shortSteps)
@@ -532,15 +2372,415 @@ public:
             }
             j["directRoutes"].push_back(move(dr));
             }
+
+            for (auto &route : result.paretoRoutes) j["paretoRoutes"].push_back(routeToJson(route));
+            if (result.hasStats) j["stats"] = statsToJson(result.stats);
+
+            for (auto &route : result.alternativeRoutes) j["alternativeRoutes"].push_back(routeToJson(route));
         }
 
         // pretty-print with 2 spaces
         return j.dump(2);
     }
 
+    // Answers many (start, target) pairs at once. Pairs are grouped by start
+    // station so a single one-to-all search serves every target of a group;
+    // groups are spread over worker threads. Results keep the input order.
+    vector<BatchResult> findRoutes(const vector<pair<long long, long long>> &pairs, int threads = 0) const
+    {
+        vector<BatchResult> results(pairs.size());
+        map<int, vector<size_t>> bySource;
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            auto [startId, targetId] = pairs[i];
+            BatchResult &r = results[i];
+            r = {startId, targetId, false, INF, INF, ""};
+            auto start = stopToIdx.find(startId);
+            if (start == stopToIdx.end()) r.error = "Start station ID " + to_string(startId) + " not found";
+            else if (stopToIdx.find(targetId) == stopToIdx.end()) r.error = "Target station ID " + to_string(targetId) + " not found";
+            else if (startId == targetId) r.error = "Start and target stations are the same";
+            else bySource[start->second].push_back(i);
+        }
+
+        vector<pair<int, vector<size_t>>> groups(bySource.begin(), bySource.end());
+        atomic<size_t> nextGroup{0};
+        auto worker = [&]()
+        {
+            vector<pair<int, int>> label;
+            vector<int> parent;
+            for (size_t g; (g = nextGroup++) < groups.size();)
+            {
+                cheapestFrom(groups[g].first, label, parent);
+                for (size_t i : groups[g].second)
+                {
+                    BatchResult &r = results[i];
+                    int s = bestArrival(stopToIdx.at(r.targetId), label);
+                    if (s == -1)
+                    {
+                        r.error = "No route found between these stations";
+                        continue;
+                    }
+                    r.found = true;
+                    tie(r.cost, r.time) = label[s];
+                }
+            }
+        };
+
+        if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+        threads = min<size_t>(threads, max<size_t>(groups.size(), 1));
+        vector<thread> pool;
+        for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool) t.join();
+        return results;
+    }
+
+    // The optimal route of every ordered pair, as findRoute would return it,
+    // reduced to its line changes and merged per source into a DAG (see
+    // TransferPatterns). One full cheapestFrom tree per source; sources are
+    // spread over worker threads.
+    TransferPatterns buildTransferPatterns(int threads = 0) const
+    {
+        int n = adjacencyList.size();
+        TransferPatterns patterns;
+        patterns.stationIds = stationIds();
+        patterns.lineNames = lineNames;
+        patterns.targetNode.assign((size_t)n * n, -1);
+        vector<vector<PatternNode>> blocks(n);
+
+        atomic<int> nextSource{0};
+        auto worker = [&]()
+        {
+            vector<pair<int, int>> label;
+            vector<int> parent, states;
+            for (int src; (src = nextSource++) < n;)
+            {
+                cheapestFrom(src, label, parent);
+                map<tuple<int, int, int, int>, int> known; // (parent, from, to, line) -> node
+                auto nodeFor = [&](int up, int from, int to, int line)
+                {
+                    auto [it, added] = known.emplace(make_tuple(up, from, to, line), blocks[src].size());
+                    if (added) blocks[src].push_back({up, from, to, line});
+                    return it->second;
+                };
+
+                for (int dest = 0; dest < n; dest++)
+                {
+                    int best = dest == src ? -1 : bestArrival(dest, label);
+                    if (best == -1) continue;
+                    states.clear();
+                    for (int x = best; x != -1; x = parent[x]) states.push_back(x);
+                    reverse(states.begin(), states.end());
+
+                    int node = nodeFor(-1, -1, src, stateLine[states[0]]);
+                    for (size_t i = 1; i < states.size(); i++)
+                    {
+                        if (stateLine[states[i]] == stateLine[states[i - 1]]) continue;
+                        node = nodeFor(node, stateStation[states[i - 1]], stateStation[states[i]], stateLine[states[i]]);
+                    }
+                    patterns.targetNode[(size_t)src * n + dest] = node;
+                }
+            }
+        };
+
+        if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+        vector<thread> pool;
+        for (int t = 1; t < min(threads, max(n, 1)); t++) pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool) t.join();
+
+        patterns.nodeOffset.assign(n + 1, 0);
+        for (int src = 0; src < n; src++)
+        {
+            patterns.nodes.insert(patterns.nodes.end(), blocks[src].begin(), blocks[src].end());
+            patterns.nodeOffset[src + 1] = patterns.nodes.size();
+        }
+        return patterns;
+    }
+
+    // True when patterns were built on this network's stations and lines
+    bool matchesPatterns(const TransferPatterns &patterns) const
+    {
+        return patterns.stationIds == stationIds() && patterns.lineNames == lineNames;
+    }
+
+    // findRoute answered from transfer patterns: the route's line changes
+    // come from the pattern DAG of the start station and each ride between
+    // them from a direct connection lookup (lineLeg). Patterns must match
+    // this network (matchesPatterns).
+    RouteResult findPatternRoute(long long startStationId, long long targetStationId, const TransferPatterns &patterns) const
+    {
+        RouteResult result;
+        result.found = false;
+
+        if (stopToIdx.find(startStationId) == stopToIdx.end()) {result.error = "Start station ID " + to_string(startStationId) + " not found"; return result;}
+
+        if (stopToIdx.find(targetStationId) == stopToIdx.end()){result.error = "Target station ID " + to_string(targetStationId) + " not found"; return result;}
+
+        if (startStationId == targetStationId) {result.error = "Start and target stations are the same"; return result;}
+
+        int src = stopToIdx.at(startStationId), dest = stopToIdx.at(targetStationId);
+        result.directRoutes = findDirectRoutes(startStationId, targetStationId);
+        int node = patterns.targetNode[(size_t)src * adjacencyList.size() + dest];
+        if (node == -1) {result.error = "No route found between these stations"; return result;}
+
+        const PatternNode *block = &patterns.nodes[patterns.nodeOffset[src]];
+        vector<PatternNode> changes;
+        for (; node != -1; node = block[node].parent) changes.push_back(block[node]);
+        reverse(changes.begin(), changes.end());
+
+        vector<int> states;
+        int cost = 0, time = 0;
+        for (size_t i = 0; i < changes.size(); i++)
+        {
+            const PatternNode &change = changes[i];
+            if (change.from != -1) time += edgeTime(change.from, change.to);
+            int legEnd = i + 1 < changes.size() ? changes[i + 1].from : dest;
+            int legTime;
+            vector<int> leg = lineLeg(change.line, change.to, legEnd, legTime);
+            if (leg.empty()) {result.error = "Transfer patterns do not match the network"; return result;}
+            for (int u : leg) states.push_back(stateOf(u, change.line));
+            cost += lineFares[change.line];
+            time += legTime;
+        }
+
+        result.optimalRoute = routeFromStates(states, startStationId, targetStationId);
+        result.optimalRoute.totalCost = cost;
+        result.optimalRoute.totalTime = time;
+        result.found = true;
+        return result;
+    }
+
+    // The optimal route of every ordered pair, as findRoute would return it,
+    // cut into rides of one line each. A ride along consecutive stops of a
+    // trip of its line is stored as (trip, board, alight); any other ride,
+    // which the state graph allows when a line's stations are also linked
+    // by other trips, keeps its station list. A route to a lower station
+    // index that is the only optimal one (uniqueTreePaths) is not stored:
+    // its reverse is the route the other way, kept in that station's block.
+    // Sources are spread over worker threads. deps, if given, receives what
+    // each source's routes use (see updateRouteStore). With a checkpoint,
+    // sources it lists as finished are taken from it and every new block is
+    // added to it. Throws if trips are too many or too long for 16 bits.
+    string buildRouteStore(int threads = 0, RouteDependencies *deps = nullptr, SourceCheckpoint *checkpoint = nullptr) const
+    {
+        const map<int, string> *finished = checkpoint ? &checkpoint->finished() : nullptr;
+        return routeStore(vector<char>(adjacencyList.size(), 1), nullptr, nullptr, threads, deps, nullptr, finished, checkpoint);
+    }
+
+    // One shard of a distributed buildRouteStore: the sources [begin, end)
+    // not yet in shard are built and added to it, with their dependency
+    // rows. mergeRouteStore assembles the store once every range is done.
+    void buildRouteStoreShard(int begin, int end, int threads, SourceCheckpoint &shard) const
+    {
+        vector<char> range(adjacencyList.size(), 0);
+        fill(range.begin() + max(begin, 0), range.begin() + min<int>(end, range.size()), 1);
+        RouteDependencies deps;
+        routeStore(range, nullptr, nullptr, threads, &deps, nullptr, &shard.finished(), &shard);
+    }
+
+    // buildRouteStore from the shard payloads of every source (see
+    // buildRouteStoreShard); the bytes equal those of a single build.
+    // Throws runtime_error when a source is missing.
+    string mergeRouteStore(const map<int, string> &shards, RouteDependencies *deps = nullptr) const
+    {
+        for (size_t src = 0; src < adjacencyList.size(); src++)
+        {
+            if (!shards.count(src)) throw runtime_error("no shard holds source " + to_string(src));
+        }
+        return routeStore(vector<char>(adjacencyList.size(), 1), nullptr, nullptr, 1, deps, nullptr, &shards);
+    }
+
+    // buildRouteStore for this network from a store built on an earlier one
+    // with its dependencies: only the sources the network changes can
+    // affect (staleSources) are searched again, the others keep their
+    // blocks. The result equals a full rebuild route for route. Throws
+    // runtime_error when the dependencies do not belong to old.
+    string updateRouteStore(const RouteStore &old, const RouteDependencies &oldDeps, int threads = 0,
+                            RouteDependencies *deps = nullptr, int *recomputed = nullptr) const
+    {
+        if (oldDeps.storeFingerprint != old.fingerprint()) throw runtime_error("route dependencies do not match the store");
+        TramRouteFinder before = fromCompiled(oldDeps.network);
+        if (before.stationIds() != old.stationIds() || oldDeps.sourceCount() != old.stationIds().size())
+        {
+            throw runtime_error("route dependencies do not match the store");
+        }
+        vector<char> stale = staleSources(before, oldDeps);
+        if (recomputed) *recomputed = count(stale.begin(), stale.end(), 1);
+        return routeStore(stale, &old, &oldDeps, threads, deps, &before);
+    }
+
+    // True when store was built on this network's stations and trips
+    bool matchesStore(const RouteStore &store) const
+    {
+        return store.stationIds() == stationIds() && store.tripCount() == trips.size();
+    }
+
+    // findRoute answered from the route store: the stored rides are laid
+    // out on the trip arrays, and fare and time are summed along them.
+    // The store must match this network (matchesStore).
+    RouteResult findStoredRoute(long long startStationId, long long targetStationId, const RouteStore &store) const
+    {
+        RouteResult result;
+        result.found = false;
+
+        if (stopToIdx.find(startStationId) == stopToIdx.end()) {result.error = "Start station ID " + to_string(startStationId) + " not found"; return result;}
+
+        if (stopToIdx.find(targetStationId) == stopToIdx.end()){result.error = "Target station ID " + to_string(targetStationId) + " not found"; return result;}
+
+        if (startStationId == targetStationId) {result.error = "Start and target stations are the same"; return result;}
+
+        result.directRoutes = findDirectRoutes(startStationId, targetStationId);
+        vector<StoredLeg> legs;
+        if (!store.route(stopToIdx.at(startStationId), stopToIdx.at(targetStationId), legs)) {result.error = "No route found between these stations"; return result;}
+
+        vector<int> states;
+        int cost = 0, time = 0;
+        for (StoredLeg &leg : legs)
+        {
+            if (leg.trip >= 0)
+            {
+                if (leg.trip >= (int)trips.size() || max(leg.board, leg.alight) >= (int)trips[leg.trip].size()) throw runtime_error("segment outside its trip");
+                leg.line = lineIds.at(tripNames[leg.trip]);
+                int step = leg.alight >= leg.board ? 1 : -1;
+                for (int i = leg.board; i != leg.alight + step; i += step) leg.stations.push_back(stopToIdx.at(trips[leg.trip][i]));
+            }
+            cost += lineFares.at(leg.line);
+            for (int u : leg.stations)
+            {
+                int s = u >= 0 && u < (int)adjacencyList.size() ? stateOf(u, leg.line) : -1;
+                int hop = states.empty() || s == -1 ? 0 : edgeTime(stateStation[states.back()], u);
+                if (s == -1 || hop == INF) throw runtime_error("stored ride leaves its line");
+                time += hop;
+                states.push_back(s);
+            }
+        }
+
+        result.optimalRoute = routeFromStates(states, startStationId, targetStationId);
+        result.optimalRoute.totalCost = cost;
+        result.optimalRoute.totalTime = time;
+        result.found = true;
+        return result;
+    }
+
+    // One JSON object per line, in the order of the query pairs
+    static string batchToNdjson(const vector<BatchResult> &results)
+    {
+        string out;
+        for (const auto &r : results)
+        {
+            json j = {{"start", r.startId}, {"end", r.targetId}, {"found", r.found}};
+            if (r.found)
+            {
+                j["cost"] = r.cost;
+                j["time"] = r.time;
+            }
+            else j["error"] = r.error;
+            out += j.dump();
+            out += '\n';
+        }
+        return out;
+    }
+
+    // Binary matrix: "TRMX", uint32 version, uint32 rows, uint32 cols,
+    // int64 row station ids, int64 column station ids, then rows * cols
+    // int32 (cost, time) cells in row-major order; -1 marks a cell that was
+    // not requested or has no route. All values are little-endian.
+    static string batchToMatrix(const vector<BatchResult> &results)
+    {
+        vector<long long> rowIds, colIds;
+        map<long long, uint32_t> rowOf, colOf;
+        for (const auto &r : results)
+        {
+            if (rowOf.emplace(r.startId, rowIds.size()).second) rowIds.push_back(r.startId);
+            if (colOf.emplace(r.targetId, colIds.size()).second) colIds.push_back(r.targetId);
+        }
+
+        vector<int32_t> cells(rowIds.size() * colIds.size() * 2, -1);
+        for (const auto &r : results)
+        {
+            if (!r.found) continue;
+            size_t cell = ((size_t)rowOf[r.startId] * colIds.size() + colOf[r.targetId]) * 2;
+            cells[cell] = r.cost;
+            cells[cell + 1] = r.time;
+        }
+
+        return travelMatrixBytes(rowIds, colIds, cells);
+    }
+
+    static string travelMatrixBytes(const vector<long long> &rowIds, const vector<long long> &colIds, const vector<int32_t> &cells)
+    {
+        uint32_t header[3] = {1, (uint32_t)rowIds.size(), (uint32_t)colIds.size()};
+        string out = "TRMX";
+        out.append((const char *)header, sizeof(header));
+        out.append((const char *)rowIds.data(), rowIds.size() * sizeof(long long));
+        out.append((const char *)colIds.data(), colIds.size() * sizeof(long long));
+        out.append((const char *)cells.data(), cells.size() * sizeof(int32_t));
+        return out;
+    }
+
+    size_t stateCount() const { return stateLine.size(); }
+
+    vector<long long> stationIds() const
+    {
+        vector<long long> ids;
+        for (const auto &entry : idxToStopId) ids.push_back(entry.second);
+        return ids;
+    }
+
+    // Best (cost, time) between every ordered pair of stations, rows and
+    // columns in stationIds() order, as int32 (cost, time) cells laid out
+    // like batchToMatrix; -1 marks unreachable pairs and the diagonal is
+    // (0, 0). Runs blocked Floyd-Warshall over the (station, line) state
+    // graph and then folds the states of each station back together.
+    vector<int32_t> allPairsMatrix(int threads = 0) const
+    {
+        int states = stateLine.size();
+        vector<PathKey> d((size_t)states * states, KEY_INF);
+        for (int s = 0; s < states; s++)
+        {
+            PathKey *row = &d[(size_t)s * states];
+            row[s] = 0;
+            for (const Edge &edge : adjacencyList[stateStation[s]])
+            {
+                for (int t = stateOffset[edge.to]; t < stateOffset[edge.to + 1]; t++)
+                {
+                    int fare = stateLine[t] == stateLine[s] ? 0 : lineFares[stateLine[t]];
+                    row[t] = min(row[t], makeKey(fare, edge.travelTime));
+                }
+            }
+        }
+        floydWarshall(d, states, threads);
+
+        int n = adjacencyList.size();
+        vector<int32_t> cells((size_t)n * n * 2, -1);
+        vector<PathKey> best(n);
+        for (int u = 0; u < n; u++)
+        {
+            fill(best.begin(), best.end(), KEY_INF);
+            for (int s = stateOffset[u]; s < stateOffset[u + 1]; s++)
+            {
+                PathKey boarding = makeKey(lineFares[stateLine[s]], 0);
+                const PathKey *row = &d[(size_t)s * states];
+                for (int t = 0; t < states; t++)
+                {
+                    if (row[t] < KEY_INF) best[stateStation[t]] = min(best[stateStation[t]], boarding + row[t]);
+                }
+            }
+            best[u] = 0;
+            for (int v = 0; v < n; v++)
+            {
+                if (best[v] >= KEY_INF) continue;
+                cells[((size_t)u * n + v) * 2] = keyCost(best[v]);
+                cells[((size_t)u * n + v) * 2 + 1] = keyTime(best[v]);
+            }
+        }
+        return cells;
+    }
+
     string findPrecomputedRoute(long long startStationId,
                                 long long targetStationId,
-                                const string &filename = "all_routes.json")
+                                const string &filename = "all_routes.json") const
     {
         ifstream in(filename);
         if (!in.is_open()) return R"({"found":false,"error":"cannot open precomputed file"})";
@@ -555,12 +2795,41 @@ public:
     }
 };
 
+// Per-thread side of route queries on a shared network. Once built, a
+// TramRouteFinder is only read by queries, so any number of contexts may
+// query one finder at the same time; each context reuses its own search
+// buffers and belongs to a single thread.
+class QueryContext
+{
+public:
+    explicit QueryContext(const TramRouteFinder &network) : network(network) {}
+
+    const TramRouteFinder &finder() const { return network; }
+
+    RouteResult findRoute(long long startStationId, long long targetStationId, const RouteOptions &options = RouteOptions())
+    {
+        return network.findRoute(startStationId, targetStationId, options, &buffers);
+    }
+
+    IsochroneResult findReachable(long long startStationId, int maxTime, int maxCost)
+    {
+        return network.findReachable(startStationId, maxTime, maxCost, &buffers);
+    }
+
+private:
+    const TramRouteFinder &network;
+    SearchBuffers buffers;
+};
+
 vector<vector<long long>> trips = {
     {316823148, 3909161113, 3880407513, 3909161121, 3909161122, 3909161123, 1886590988, 1886590968, 4792326286, 8412131579, 316824347, 5969128858, 3950015169, 316829952, 4628330183, 4748562215, 1885060212, 4002201650, 4748507684, 6095379250, 316824433, 401866306, 10970120024, 6095433434, 6095471258, 6095433435, 6095519914, 4984424561, 1263172984, 1263173062, 316824788},
     {316823148, 3909161113, 3880407513, 3909161121, 3909161122, 3909161123, 1886590988, 4002201610, 4478874013, 4478874012, 4669952291, 8412131578, 316829952, 4628330183, 4748562215, 1885060212, 4002201652, 6095358858, 316824433, 401866306, 10970120024, 6095433434, 6095471258, 6095433435, 6095519914, 4984424561, 1263172984, 1263173062, 316824788},
     {1886590988, 1886590968, 4792326286, 8412131579, 316824347, 5969128858, 3950015169, 316829952, 4628330183, 4748562215, 1885060212, 4002201650, 4748507684, 6095379250, 316824433, 401866306, 10970120024, 6095433434, 6095471258, 6095433435, 6095519914, 4984424561, 1263172984, 1263173062},
     {1886590988, 4002201610, 4478874013, 4478874012, 4669952291, 8412131578, 316829952, 4628330183, 4748562215, 1885060212, 4002201652, 6095358858, 316824433, 401866306, 10970120024, 6095433434, 6095471258, 6095433435, 6095519914, 4984424561, 1263172984, 1263173062}};
 vector<string> tripNames = {"B1", "B2", "Y1", "Y2"};
+// Fare of each line; the CLI, its daemons and every precomputed file use
+// this one table so their fares agree
+const map<string, int> linePrices = {{"B1", 5}, {"B2", 5}, {"Y1", 10}, {"Y2", 10}};
 
 map<long long, string> stationNames = {
     {316823148, "El Nasr Station"}, {316824347, "Bakus"}, {316824433, "Sporting El-Kobra Station"}, {316824788, "Ramleh Station"}, {316829952, "Bulky Station"}, {401866306, "Sporting El Soghra"}, {1263172984, "El Azarita Station"}, {1263173062, "Ibrahim Mosque Station"}, {1885060212, "Moustafa Kamel"}, {1886590968, "Gnaklis Station"}, {1886590988, "San Stefano"}, {3880407513, "Sidi Bishr"}, {3909161113, "El Suyuf Station"}, {3909161121, "El Saraya"}, {3909161122, "Luran Station"}, {3909161123, "Tharwat Station"}, {3950015169, "El Wezarah"}, {4002201610, "Qasr El-Safa"}, {4002201650, "Sidi Gaber El Sheikh"}, {4002201652, "Sidi Gaber El Mahatta"}, {4478874012, "Gleem Station"}, {4478874013, "El-Fonoon El-Gamila"}, {4628330183, "Roshdy Station"}, {4669952291, "Saba Basha Station"}, {4748507684, "Cleopatra El Kobra Station"}, {4748562215, "Mohamed Mahfouz Station"}, {4792326286, "Shots Station"}, {4984424561, "El Shahid Mustafa Zayan Station"}, {5969128858, "Fleming Station"}, {6095358858, "Cleopatra Station"}, {6095379250, "Cleopatra Alsoghra Tram Station"}, {6095433434, "Camp Chezar"}, {6095433435, "El Shatby Station"}, {6095471258, "El Gamaa"}, {6095519914, "El Shoban El Muslmen Station"}, {8412131578, "El Hadaya Station"}, {8412131579, "Safer Station"}, {10970120024, "Al Ibrahimia Station"}};
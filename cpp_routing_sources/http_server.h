@@ -0,0 +1,388 @@
+#pragma once
+#include <bits/stdc++.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "query_executor.h"
+using namespace std;
+
+// One parsed request; every view points into the connection's input
+// buffer and is valid only while the handler runs
+struct HttpRequest
+{
+    string_view method;
+    string_view path;
+    string_view query; // after '?', empty when there is none
+    bool keepAlive = true;
+
+    // The raw value of name in the query string, not percent-decoded;
+    // empty when it is missing
+    string_view param(string_view name) const
+    {
+        for (size_t at = 0; at <= query.size();)
+        {
+            size_t end = query.find('&', at);
+            if (end == string_view::npos) end = query.size();
+            string_view pair = query.substr(at, end - at);
+            size_t equals = pair.find('=');
+            if (pair.substr(0, equals) == name) return equals == string_view::npos ? string_view() : pair.substr(equals + 1);
+            at = end + 1;
+        }
+        return {};
+    }
+};
+
+struct HttpResponse
+{
+    int status = 200;
+    const char *contentType = "application/json";
+    string body;
+};
+
+// Non-blocking HTTP/1.1 server on epoll: one event loop per core, pinned,
+// all waiting on one listening socket (EPOLLEXCLUSIVE wakes a single loop
+// per connection). Each loop owns a Workspace built on its thread and
+// answers the requests of its connections inline, so a request never
+// changes threads. Connections are kept alive and may pipeline: every
+// complete request in the input is answered in order, and the responses
+// leave with writev, headers next to the handler's body without copying
+// it. Requests with a body are not expected and are refused.
+template <class Workspace>
+class HttpServer
+{
+public:
+    using Handler = function<void(const HttpRequest &, HttpResponse &, Workspace &)>;
+
+    static constexpr size_t MAX_HEADER = 16 << 10;
+    static constexpr size_t MAX_PENDING_OUTPUT = 4 << 20; // stop parsing above this
+    static constexpr int MAX_EVENTS = 256;
+
+    // port 0 picks a free one (see port()); loops <= 0 means one per core
+    template <class... Args>
+    HttpServer(int port, int loops, Handler handler, const Args &...args) : handler(move(handler))
+    {
+        listener = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listener < 0) throw runtime_error(string("socket: ") + strerror(errno));
+        int on = 1, off = 0;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(listener, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        sockaddr_in6 address{};
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_any;
+        address.sin6_port = htons(port);
+        if (bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0)
+        {
+            string error = strerror(errno);
+            close(listener);
+            throw runtime_error("cannot listen on port " + to_string(port) + ": " + error);
+        }
+        socklen_t length = sizeof(address);
+        getsockname(listener, (sockaddr *)&address, &length);
+        boundPort = ntohs(address.sin6_port);
+        stopper = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (loops <= 0) loops = allowedCores().size();
+        threads = spawnWorkers<Workspace>(loops, true, [this](int, Workspace &workspace) { run(workspace); }, args...);
+    }
+
+    HttpServer(const HttpServer &) = delete;
+    HttpServer &operator=(const HttpServer &) = delete;
+
+    ~HttpServer()
+    {
+        stop();
+        for (thread &t : threads) t.join();
+        close(listener);
+        close(stopper);
+    }
+
+    int port() const { return boundPort; }
+
+    // Makes every loop close its connections and return
+    void stop()
+    {
+        uint64_t one = 1;
+        if (write(stopper, &one, sizeof(one)) < 0) perror("eventfd");
+    }
+
+private:
+    struct Connection
+    {
+        int fd;
+        string input;
+        deque<string> output;
+        size_t written = 0; // of output.front()
+        size_t pending = 0; // bytes in output
+        bool closing = false; // after output drains
+        uint32_t watching = EPOLLIN | EPOLLRDHUP;
+    };
+
+    Handler handler;
+    int listener = -1, stopper = -1, boundPort = 0;
+    vector<thread> threads;
+
+    void run(Workspace &workspace)
+    {
+        int poller = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.ptr = &listener;
+        epoll_ctl(poller, EPOLL_CTL_ADD, listener, &event);
+        event.events = EPOLLIN;
+        event.data.ptr = &stopper;
+        epoll_ctl(poller, EPOLL_CTL_ADD, stopper, &event);
+
+        unordered_map<int, unique_ptr<Connection>> connections;
+        epoll_event events[MAX_EVENTS];
+        for (bool running = true; running;)
+        {
+            int count = epoll_wait(poller, events, MAX_EVENTS, -1);
+            if (count < 0 && errno != EINTR) break;
+            for (int e = 0; e < count; e++)
+            {
+                if (events[e].data.ptr == &stopper)
+                {
+                    running = false;
+                    continue;
+                }
+                if (events[e].data.ptr == &listener)
+                {
+                    accept(poller, connections);
+                    continue;
+                }
+                Connection &connection = *(Connection *)events[e].data.ptr;
+                bool open = true;
+                if (events[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) open = receive(connection, workspace);
+                open = open && flush(poller, connection);
+                // requests held back while output piled up
+                while (open && connection.pending < MAX_PENDING_OUTPUT && !connection.closing && !connection.input.empty())
+                {
+                    size_t before = connection.input.size();
+                    answer(connection, workspace);
+                    open = flush(poller, connection);
+                    if (connection.input.size() == before) break;
+                }
+                if (!open || (connection.closing && connection.output.empty()))
+                {
+                    close(connection.fd);
+                    connections.erase(connection.fd);
+                }
+            }
+        }
+        for (auto &entry : connections) close(entry.first);
+        close(poller);
+    }
+
+    void accept(int poller, unordered_map<int, unique_ptr<Connection>> &connections)
+    {
+        for (;;)
+        {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN: another loop took it, or none left
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            auto connection = make_unique<Connection>();
+            connection->fd = fd;
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.ptr = connection.get();
+            epoll_ctl(poller, EPOLL_CTL_ADD, fd, &event);
+            connections[fd] = move(connection);
+        }
+    }
+
+    // Reads what has arrived and answers the complete requests in it;
+    // false when the connection is to be dropped at once. The complete
+    // requests are answered before each read, so the input holds at most
+    // one partial request and a read's worth more: reading stops once that
+    // passes MAX_HEADER, and the rest waits in the socket (epoll is level
+    // triggered) until output drains or the request is refused.
+    bool receive(Connection &connection, Workspace &workspace)
+    {
+        for (;;)
+        {
+            answer(connection, workspace);
+            if (connection.closing || connection.pending >= MAX_PENDING_OUTPUT || connection.input.size() > MAX_HEADER)
+                return true;
+            size_t used = connection.input.size();
+            connection.input.resize(used + 16384);
+            ssize_t got = read(connection.fd, &connection.input[used], 16384);
+            connection.input.resize(used + max<ssize_t>(got, 0));
+            if (got > 0 || (got < 0 && errno == EINTR)) continue;
+            if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            if (got == 0) connection.closing = true;
+            return true;
+        }
+    }
+
+    // Parses and answers the buffered requests while output is not piling up
+    void answer(Connection &connection, Workspace &workspace)
+    {
+        string_view input = connection.input;
+        size_t consumed = 0;
+        while (!connection.closing && connection.pending < MAX_PENDING_OUTPUT)
+        {
+            size_t end = input.find("\r\n\r\n", consumed);
+            if (end == string_view::npos)
+            {
+                if (input.size() - consumed > MAX_HEADER) fail(connection, 431, "request header too large");
+                break;
+            }
+            HttpRequest request;
+            int refused = parse(input.substr(consumed, end - consumed), request);
+            consumed = end + 4;
+            if (refused)
+            {
+                fail(connection, refused, refused == 501 ? "request bodies are not supported" : "malformed request");
+                break;
+            }
+
+            HttpResponse response;
+            try
+            {
+                handler(request, response, workspace);
+            }
+            catch (const exception &e)
+            {
+                response = {500, "text/plain; charset=utf-8", string(e.what()) + "\n"};
+            }
+            if (!request.keepAlive) connection.closing = true;
+            queue(connection, response);
+        }
+        connection.input.erase(0, consumed);
+    }
+
+    // Fills request from the request line and headers; 0, or the status
+    // to refuse it with
+    static int parse(string_view head, HttpRequest &request)
+    {
+        size_t lineEnd = head.find("\r\n");
+        string_view line = head.substr(0, lineEnd);
+        size_t space = line.find(' '), last = line.rfind(' ');
+        if (space == string_view::npos || last == space) return 400;
+        request.method = line.substr(0, space);
+        string_view target = line.substr(space + 1, last - space - 1), version = line.substr(last + 1);
+        if (version != "HTTP/1.1" && version != "HTTP/1.0") return 400;
+        request.keepAlive = version == "HTTP/1.1";
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        if (question != string_view::npos) request.query = target.substr(question + 1);
+
+        while (lineEnd != string_view::npos)
+        {
+            size_t start = lineEnd + 2;
+            lineEnd = head.find("\r\n", start);
+            string_view header = head.substr(start, lineEnd == string_view::npos ? string_view::npos : lineEnd - start);
+            size_t colon = header.find(':');
+            if (colon == string_view::npos) return 400;
+            string_view name = header.substr(0, colon), value = header.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            if (equalsIgnoringCase(name, "connection"))
+            {
+                if (containsIgnoringCase(value, "close")) request.keepAlive = false;
+                else if (containsIgnoringCase(value, "keep-alive")) request.keepAlive = true;
+            }
+            else if (equalsIgnoringCase(name, "transfer-encoding") ||
+                     (equalsIgnoringCase(name, "content-length") && value != "0"))
+                return 501;
+        }
+        return 0;
+    }
+
+    static bool equalsIgnoringCase(string_view a, string_view b)
+    {
+        return a.size() == b.size() && equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return tolower(x) == tolower(y); });
+    }
+
+    static bool containsIgnoringCase(string_view text, string_view word)
+    {
+        for (size_t i = 0; i + word.size() <= text.size(); i++)
+            if (equalsIgnoringCase(text.substr(i, word.size()), word)) return true;
+        return false;
+    }
+
+    static const char *reason(int status)
+    {
+        switch (status)
+        {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        default: return "Internal Server Error";
+        }
+    }
+
+    static void fail(Connection &connection, int status, const string &message)
+    {
+        HttpResponse response{status, "text/plain; charset=utf-8", message + "\n"};
+        connection.closing = true;
+        queue(connection, response);
+    }
+
+    static void queue(Connection &connection, HttpResponse &response)
+    {
+        string head = "HTTP/1.1 " + to_string(response.status) + " " + reason(response.status) +
+                      "\r\nContent-Type: " + response.contentType + "\r\nContent-Length: " + to_string(response.body.size()) +
+                      (connection.closing ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n");
+        connection.pending += head.size() + response.body.size();
+        connection.output.push_back(move(head));
+        if (!response.body.empty()) connection.output.push_back(move(response.body));
+    }
+
+    // Writes as much queued output as the socket takes and watches for
+    // writability while some is left; false when the connection broke
+    bool flush(int poller, Connection &connection)
+    {
+        while (!connection.output.empty())
+        {
+            iovec chunks[64];
+            int count = 0;
+            for (auto it = connection.output.begin(); it != connection.output.end() && count < 64; ++it, ++count)
+            {
+                size_t skip = count == 0 ? connection.written : 0;
+                chunks[count] = {(void *)(it->data() + skip), it->size() - skip};
+            }
+            ssize_t sent = writev(connection.fd, chunks, count);
+            if (sent < 0)
+            {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                break;
+            }
+            connection.pending -= sent;
+            for (size_t left = sent; left > 0;)
+            {
+                size_t rest = connection.output.front().size() - connection.written;
+                if (left < rest)
+                {
+                    connection.written += left;
+                    break;
+                }
+                left -= rest;
+                connection.output.pop_front();
+                connection.written = 0;
+            }
+        }
+        // no more reading once closing, or while the peer is not taking
+        // its answers
+        bool reading = !connection.closing && connection.pending < MAX_PENDING_OUTPUT;
+        uint32_t watch = (reading ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0u) | (connection.output.empty() ? 0u : uint32_t(EPOLLOUT));
+        if (watch != connection.watching)
+        {
+            epoll_event event{};
+            event.events = watch;
+            event.data.ptr = &connection;
+            epoll_ctl(poller, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.watching = watch;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,98 @@
+#include <bits/stdc++.h>
+#include "hub_labels.h"
+#include "route_service.h"
+using namespace std;
+
+// Hub label file: the HubLabels block (see HubLabels::save) followed by the
+// station ids of the label indices, as a vector of int64.
+
+static double msSince(chrono::steady_clock::time_point started) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+}
+
+// build [out.bin] [--threads=N]
+static int runBuild(const string& outputFilename, int threads) {
+    TramRouteFinder finder = loadFinder(true, false);
+    if (!finder.hasContractionHierarchy()) finder.buildContractionHierarchy(threads);
+
+    HubLabels labels;
+    auto started = chrono::steady_clock::now();
+    labels.build(finder.contractionHierarchy(), threads);
+    double buildMs = msSince(started);
+
+    BinaryWriter out;
+    labels.save(out);
+    out.putVector(finder.stationIds());
+    ofstream outFile(outputFilename, ios::binary);
+    if (!outFile.is_open()) {
+        cerr << "Failed to open output file: " << outputFilename << endl;
+        return 1;
+    }
+    outFile.write(out.bytes.data(), out.bytes.size());
+    cout << "Built " << labels.entryCount() << " hub label entries for " << labels.nodeCount() << " stations in "
+         << buildMs << " ms, wrote " << out.bytes.size() << " bytes to " << outputFilename << endl;
+    return 0;
+}
+
+// query <startId> <targetId> [labels.bin]
+static int runQuery(long long startId, long long targetId, const string& filename) {
+    string bytes = readBinaryFile(filename);
+    if (bytes.empty()) {
+        cerr << "Failed to read " << filename << endl;
+        return 1;
+    }
+    HubLabels labels;
+    vector<long long> ids;
+    try {
+        BinaryReader in(bytes);
+        labels.load(in);
+        ids = in.getVector<long long>();
+        if (ids.size() != labels.nodeCount()) throw runtime_error("station count does not match labels");
+    } catch (const exception& e) {
+        cerr << "Invalid hub label file: " << e.what() << endl;
+        return 1;
+    }
+
+    auto indexOf = [&](long long id) {
+        auto it = lower_bound(ids.begin(), ids.end(), id);
+        return it != ids.end() && *it == id ? int(it - ids.begin()) : -1;
+    };
+    int s = indexOf(startId), t = indexOf(targetId);
+    json j = {{"start", startId}, {"end", targetId}};
+    if (s == -1 || t == -1) {
+        j["found"] = false;
+        j["error"] = (s == -1 ? "Start station ID " + to_string(startId) : "Target station ID " + to_string(targetId)) + " not found";
+    } else if (int time = labels.query(s, t); time == HubLabels::UNREACHABLE) {
+        j["found"] = false;
+        j["error"] = "No route found between these stations";
+    } else {
+        j["found"] = true;
+        j["time"] = time;
+    }
+    cout << j.dump() << "\n";
+    return j["found"] ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    string mode = argc > 1 ? argv[1] : "";
+    int threads = 0;
+    vector<string> args;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) threads = atoi(arg.c_str() + 10);
+        else args.push_back(arg);
+    }
+
+    try {
+        if (mode == "build" && args.size() <= 1) return runBuild(args.empty() ? "hub_labels.bin" : args[0], threads);
+        if (mode == "query" && (args.size() == 2 || args.size() == 3))
+            return runQuery(stoll(args[0]), stoll(args[1]), args.size() == 3 ? args[2] : "hub_labels.bin");
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    cerr << "Usage: " << argv[0] << " build [out.bin] [--threads=N]\n"
+         << "       " << argv[0] << " query <startId> <targetId> [labels.bin]\n";
+    return 1;
+}
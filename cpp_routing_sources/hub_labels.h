@@ -0,0 +1,233 @@
+#pragma once
+#include <bits/stdc++.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "binary_io.h"
+#include "ch.h"
+using namespace std;
+
+// std::allocator with a fixed alignment, for cache-line aligned arrays
+template <class T, size_t Align>
+struct AlignedAllocator
+{
+    typedef T value_type;
+    template <class U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Align> other;
+    };
+
+    AlignedAllocator() = default;
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+    T *allocate(size_t n) { return (T *)::operator new(n * sizeof(T), align_val_t(Align)); }
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(Align)); }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Align> &) const { return true; }
+    template <class U>
+    bool operator!=(const AlignedAllocator<U, Align> &) const { return false; }
+};
+
+// Hub labels derived from a contraction hierarchy: the label of v holds
+// (hub, distance) for every node reachable upward from v whose distance the
+// upward search gets right, so the distance between s and t is the minimum
+// of d(s, h) + d(h, t) over hubs h common to both labels. Labels are sorted
+// by hub and padded to whole cache lines; hubs and distances live in two
+// parallel 64-byte aligned arrays.
+class HubLabels
+{
+public:
+    static constexpr int UNREACHABLE = INT_MAX;
+    static constexpr int LINE = 16; // int32 entries per cache line
+
+    bool empty() const { return offset.empty(); }
+    size_t nodeCount() const { return offset.empty() ? 0 : offset.size() - 1; }
+    size_t paddedEntries() const { return hubs.size(); }
+    size_t entryCount() const
+    {
+        size_t count = 0;
+        for (int32_t hub : hubs) count += hub != PAD_HUB;
+        return count;
+    }
+    size_t bytes() const { return hubs.size() * 2 * sizeof(int32_t) + offset.size() * sizeof(uint32_t); }
+
+    // Labels are built from the top of the hierarchy down: a node's label
+    // merges those of its upward neighbours, shifted by the arc weight, with
+    // the node itself at distance 0. An entry is pruned when the labels
+    // already give a shorter distance to its hub. Nodes of equal height
+    // (longest upward path) do not depend on each other and run in parallel.
+    void build(const ContractionHierarchy &ch, int threads = 0)
+    {
+        if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+        int n = ch.nodeCount();
+        const vector<int> &upOffset = ch.offsets(), &upTo = ch.targets(), &upWeight = ch.weights();
+
+        vector<int> order(n);
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](int a, int b) { return ch.rankOf(a) > ch.rankOf(b); });
+        vector<int> height(n, 0);
+        int maxHeight = 0;
+        for (int v : order)
+        {
+            for (int a = upOffset[v]; a < upOffset[v + 1]; a++) height[v] = max(height[v], height[upTo[a]] + 1);
+            maxHeight = max(maxHeight, height[v]);
+        }
+        vector<vector<int>> levels(maxHeight + 1);
+        for (int v : order) levels[height[v]].push_back(v);
+
+        vector<vector<pair<int, int>>> labels(n);
+        for (const vector<int> &level : levels)
+        {
+            atomic<size_t> next{0};
+            auto worker = [&]()
+            {
+                for (size_t i; (i = next++) < level.size();)
+                {
+                    int v = level[i];
+                    vector<pair<int, int>> merged = {{v, 0}};
+                    for (int a = upOffset[v]; a < upOffset[v + 1]; a++)
+                    {
+                        for (auto [hub, d] : labels[upTo[a]]) merged.emplace_back(hub, d + upWeight[a]);
+                    }
+                    sort(merged.begin(), merged.end());
+                    merged.erase(unique(merged.begin(), merged.end(), [](auto &x, auto &y) { return x.first == y.first; }), merged.end());
+
+                    vector<pair<int, int>> kept;
+                    for (auto [hub, d] : merged)
+                    {
+                        if (hub == v || scalarMerge(merged, labels[hub]) >= d) kept.emplace_back(hub, d);
+                    }
+                    labels[v] = move(kept);
+                }
+            };
+            vector<thread> pool;
+            for (size_t t = 1; t < min<size_t>(threads, level.size()); t++) pool.emplace_back(worker);
+            worker();
+            for (auto &t : pool) t.join();
+        }
+
+        offset.assign(n + 1, 0);
+        for (int v = 0; v < n; v++) offset[v + 1] = offset[v] + (labels[v].size() + LINE - 1) / LINE * LINE;
+        hubs.assign(offset[n], PAD_HUB);
+        dists.assign(offset[n], PAD_DIST);
+        for (int v = 0; v < n; v++)
+        {
+            for (size_t i = 0; i < labels[v].size(); i++)
+            {
+                hubs[offset[v] + i] = labels[v][i].first;
+                dists[offset[v] + i] = labels[v][i].second;
+            }
+        }
+    }
+
+    // Exact distance between s and t, or UNREACHABLE
+    int query(int s, int t) const
+    {
+        const int32_t *hs = &hubs[offset[s]], *ds = &dists[offset[s]];
+        const int32_t *ht = &hubs[offset[t]], *dt = &dists[offset[t]];
+        size_t ns = offset[s + 1] - offset[s], nt = offset[t + 1] - offset[t];
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+        int best = hasAvx2 ? mergeAvx2(hs, ds, ns, ht, dt, nt) : mergeScalar(hs, ds, ns, ht, dt, nt);
+#else
+        int best = mergeScalar(hs, ds, ns, ht, dt, nt);
+#endif
+        return best >= PAD_DIST ? UNREACHABLE : best;
+    }
+
+    // "TRHL", uint32 version, then the label offsets, hubs and distances
+    void save(BinaryWriter &out) const
+    {
+        out.bytes += "TRHL";
+        out.put<uint32_t>(VERSION);
+        out.putVector(offset);
+        out.putVector(vector<int32_t>(hubs.begin(), hubs.end()));
+        out.putVector(vector<int32_t>(dists.begin(), dists.end()));
+    }
+
+    // Inverse of save(); throws runtime_error on malformed input
+    void load(BinaryReader &in)
+    {
+        in.expectMagic("TRHL");
+        if (in.get<uint32_t>() != VERSION) throw runtime_error("unsupported hub label version");
+        offset = in.getVector<uint32_t>();
+        vector<int32_t> h = in.getVector<int32_t>(), d = in.getVector<int32_t>();
+        bool ok = !offset.empty() && offset[0] == 0 && offset.back() == h.size() && d.size() == h.size();
+        for (size_t v = 0; ok && v + 1 < offset.size(); v++) ok = offset[v] <= offset[v + 1] && (offset[v + 1] - offset[v]) % LINE == 0;
+        for (size_t i = 0; ok && i < h.size(); i++) ok = h[i] == PAD_HUB || (h[i] >= 0 && (size_t)h[i] + 1 < offset.size());
+        if (!ok) throw runtime_error("corrupt hub labels");
+        hubs.assign(h.begin(), h.end());
+        dists.assign(d.begin(), d.end());
+    }
+
+private:
+    static constexpr uint32_t VERSION = 1;
+    // Padding sorts after every hub; two paddings meeting sum to 2 * PAD_DIST
+    static constexpr int32_t PAD_HUB = INT_MAX;
+    static constexpr int32_t PAD_DIST = 1 << 29;
+
+    vector<uint32_t> offset;
+    vector<int32_t, AlignedAllocator<int32_t, 64>> hubs;
+    vector<int32_t, AlignedAllocator<int32_t, 64>> dists;
+
+    static int scalarMerge(const vector<pair<int, int>> &a, const vector<pair<int, int>> &b)
+    {
+        long long best = UNREACHABLE;
+        for (size_t i = 0, j = 0; i < a.size() && j < b.size();)
+        {
+            if (a[i].first < b[j].first) i++;
+            else if (a[i].first > b[j].first) j++;
+            else best = min(best, (long long)a[i++].second + b[j++].second);
+        }
+        return (int)min<long long>(best, UNREACHABLE);
+    }
+
+    static int mergeScalar(const int32_t *ha, const int32_t *da, size_t na, const int32_t *hb, const int32_t *db, size_t nb)
+    {
+        int best = 2 * PAD_DIST;
+        for (size_t i = 0, j = 0; i < na && j < nb;)
+        {
+            if (ha[i] < hb[j]) i++;
+            else if (ha[i] > hb[j]) j++;
+            else best = min(best, da[i++] + db[j++]);
+        }
+        return best;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Block merge eight entries at a time: every rotation of b's block is
+    // compared with a's, matching lanes contribute da + db, and the block
+    // with the smaller last hub moves on
+    __attribute__((target("avx2"))) static int mergeAvx2(const int32_t *ha, const int32_t *da, size_t na,
+                                                         const int32_t *hb, const int32_t *db, size_t nb)
+    {
+        __m256i best = _mm256_set1_epi32(2 * PAD_DIST);
+        const __m256i none = best;
+        const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        for (size_t i = 0, j = 0; i < na && j < nb;)
+        {
+            __m256i va = _mm256_load_si256((const __m256i *)(ha + i));
+            __m256i wa = _mm256_load_si256((const __m256i *)(da + i));
+            __m256i vb = _mm256_load_si256((const __m256i *)(hb + j));
+            __m256i wb = _mm256_load_si256((const __m256i *)(db + j));
+            for (int r = 0; r < 8; r++)
+            {
+                __m256i match = _mm256_cmpeq_epi32(va, vb);
+                best = _mm256_min_epi32(best, _mm256_blendv_epi8(none, _mm256_add_epi32(wa, wb), match));
+                vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                wb = _mm256_permutevar8x32_epi32(wb, rotate);
+            }
+            int lastA = ha[i + 7], lastB = hb[j + 7];
+            if (lastA <= lastB) i += 8;
+            if (lastB <= lastA) j += 8;
+        }
+        __m128i half = _mm_min_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+        half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(half);
+    }
+#endif
+};
@@ -0,0 +1,95 @@
+#include <bits/stdc++.h>
+#include "librouting.h"
+#include "route_service.h"
+using namespace std;
+
+// Build as a static or shared library:
+//   g++ -std=gnu++17 -O2 -fPIC -c librouting.cpp -o librouting.o && ar rcs librouting.a librouting.o
+//   g++ -std=gnu++17 -O2 -fPIC -shared librouting.cpp -o librouting.so
+
+struct routing_network {
+    RouteService service;
+    // search buffers of finished queries, handed to the next ones; a
+    // caller's thread may change between calls (goroutines do)
+    mutex guard;
+    vector<unique_ptr<QueryContext>> idle;
+
+    routing_network(size_t cacheMb, size_t hotRoutes) : service(cacheMb, hotRoutes) {}
+
+    unique_ptr<QueryContext> acquire() {
+        lock_guard<mutex> lock(guard);
+        if (idle.empty()) return make_unique<QueryContext>(service.finder);
+        unique_ptr<QueryContext> context = move(idle.back());
+        idle.pop_back();
+        return context;
+    }
+
+    void release(unique_ptr<QueryContext> context) {
+        lock_guard<mutex> lock(guard);
+        idle.push_back(move(context));
+    }
+};
+
+// Copies answer to buffer when it fits; the status to return
+static int deliver(const string& answer, int status, char* buffer, size_t capacity, size_t* length) {
+    *length = answer.size();
+    if (answer.size() > capacity) return ROUTING_BUFFER_TOO_SMALL;
+    memcpy(buffer, answer.data(), answer.size());
+    return status;
+}
+
+static int answer(routing_network* network, const char* const* args, int argCount, string& out) {
+    try {
+        unique_ptr<QueryContext> context = network->acquire();
+        int status = network->service.answer(*context, vector<string>(args, args + max(argCount, 0)), out);
+        network->release(move(context));
+        return status;
+    } catch (const exception& e) {
+        out = e.what();
+        return ROUTING_FAILED;
+    }
+}
+
+extern "C" {
+
+routing_network* routing_open(size_t cache_mb, size_t hot_routes, char* error, size_t error_size) {
+    try {
+        return new routing_network(cache_mb, hot_routes);
+    } catch (const exception& e) {
+        if (error && error_size > 0) snprintf(error, error_size, "%s", e.what());
+        return nullptr;
+    }
+}
+
+void routing_close(routing_network* network) {
+    delete network;
+}
+
+int routing_query(routing_network* network, const char* const* args, int arg_count, char* buffer, size_t capacity,
+                  size_t* length) {
+    if (arg_count < 3) return deliver("Invalid request: expected <startId> <targetId> <mode>\n", 1, buffer, capacity, length);
+    string out;
+    int status = answer(network, args, arg_count, out);
+    return deliver(out, status, buffer, capacity, length);
+}
+
+int routing_query_alloc(routing_network* network, const char* const* args, int arg_count, char** result,
+                        size_t* length) {
+    string out = "Invalid request: expected <startId> <targetId> <mode>\n";
+    int status = arg_count < 3 ? 1 : answer(network, args, arg_count, out);
+    *result = (char*)malloc(max<size_t>(out.size(), 1));
+    if (!*result) return ROUTING_FAILED;
+    memcpy(*result, out.data(), out.size());
+    *length = out.size();
+    return status;
+}
+
+void routing_free(char* result) {
+    free(result);
+}
+
+int routing_stats(routing_network* network, char* buffer, size_t capacity, size_t* length) {
+    return deliver(network->service.stats(), 0, buffer, capacity, length);
+}
+
+}
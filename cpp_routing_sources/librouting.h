@@ -0,0 +1,53 @@
+#ifndef LIBROUTING_H
+#define LIBROUTING_H
+#include <stddef.h>
+
+// C API of the route finder, for callers in the same process (the Go
+// server through cgo). A routing_network holds what `routing serve` loads
+// once: the compiled network, the precomputed files, the result cache and
+// the route tiers, read from the working directory like the routing CLI.
+// It is safe to query from any number of threads at once.
+//
+// Queries answer into a buffer the caller owns: the answer is written
+// straight into it, and *length is set to the answer's full size. When
+// that exceeds capacity, nothing is written and ROUTING_BUFFER_TOO_SMALL
+// is returned; call again with at least *length bytes (the repeat is
+// usually answered from the cache).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROUTING_BUFFER_TOO_SMALL (-1)
+#define ROUTING_FAILED (-2) // the answer holds the error message
+
+typedef struct routing_network routing_network;
+
+// Loads the network; NULL on failure, with the reason in error (at most
+// error_size bytes, NUL-terminated)
+routing_network *routing_open(size_t cache_mb, size_t hot_routes, char *error, size_t error_size);
+
+void routing_close(routing_network *network);
+
+// Answers one route query given as the routing CLI's arguments, e.g.
+// {"316823148", "316824788", "alternatives", "--k=3"}. The answer is what
+// the CLI would print (stdout, then stderr) and the result its exit
+// status, or one of the negative codes above.
+int routing_query(routing_network *network, const char *const *args, int arg_count, char *buffer, size_t capacity,
+                  size_t *length);
+
+// Like routing_query, into a buffer the library allocates; release it
+// with routing_free
+int routing_query_alloc(routing_network *network, const char *const *args, int arg_count, char **answer,
+                        size_t *length);
+
+void routing_free(char *answer);
+
+// The result cache and tier counters as JSON, like `<id> stats` in serve
+int routing_stats(routing_network *network, char *buffer, size_t capacity, size_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,53 +1,462 @@
 #include <bits/stdc++.h>
-#include "helper.h"
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "http_server.h"
+#include "query_executor.h"
+#include "route_service.h"
 using namespace std;
-int main(int argc, char* argv[]) {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
 
-    if (argc != 4) {
-        cerr << "Usage: " << argv[0] << " <startId> <targetId> <type: realtime|precomputed>\n";
+// The one-shot commands below load the network they need, or run on warm,
+// the network a zygote loaded before forking them (see runZygote)
+
+// batch <pairsFile|-> [--format=ndjson|matrix] [--threads=N]
+// Each input line holds one "startId targetId" pair (space or comma separated).
+int runBatch(int argc, char* argv[], const RouteService* warm = nullptr) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " batch <pairsFile|-> [--format=ndjson|matrix] [--threads=N]\n";
         return 1;
     }
 
-    long long startId, targetId;
+    string format = "ndjson";
+    int threads = 0;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        try {
+            if (arg.rfind("--format=", 0) == 0) format = arg.substr(9);
+            else if (arg.rfind("--threads=", 0) == 0) threads = stoi(arg.substr(10));
+            else { cerr << "Unknown option: " << arg << "\n"; return 1; }
+        } catch (const exception& e) {
+            cerr << "Invalid option " << arg << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+    if (format != "ndjson" && format != "matrix") {
+        cerr << "Unknown format: " << format << "\n";
+        return 1;
+    }
+
+    string pairsContent = string(argv[2]) == "-" ? string(istreambuf_iterator<char>(cin), {}) : readFileContent(argv[2]);
+    vector<pair<long long, long long>> pairs;
+    istringstream in(pairsContent);
+    string line;
+    for (int lineNo = 1; getline(in, line); lineNo++) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        replace(line.begin(), line.end(), ',', ' ');
+        // exactly two ids: answers come back one per pair in request order,
+        // so a line that is not a pair fails the batch instead of vanishing
+        istringstream fields(line);
+        long long startId, targetId;
+        if (!(fields >> startId >> targetId) || !(fields >> ws).eof()) {
+            cerr << "Invalid pair on line " << lineNo << ": " << line << "\n";
+            return 1;
+        }
+        pairs.emplace_back(startId, targetId);
+    }
+
+    optional<TramRouteFinder> loaded;
+    const TramRouteFinder& finder = warm ? warm->finder : loaded.emplace(loadFinder(true, false));
+
+    auto results = finder.findRoutes(pairs, threads);
+    string out = format == "matrix" ? TramRouteFinder::batchToMatrix(results) : TramRouteFinder::batchToNdjson(results);
+    cout.write(out.data(), out.size());
+    return 0;
+}
+
+// isochrone <startId> <maxMinutes> <maxCost>
+int runIsochrone(int argc, char* argv[], const RouteService* warm = nullptr) {
+    if (argc != 5) {
+        cerr << "Usage: " << argv[0] << " isochrone <startId> <maxMinutes> <maxCost>\n";
+        return 1;
+    }
+
+    long long startId;
+    int maxTime, maxCost;
     try {
-        startId  = stoll(argv[1]);
-        targetId = stoll(argv[2]);
+        startId = stoll(argv[2]);
+        maxTime = stoi(argv[3]);
+        maxCost = stoi(argv[4]);
     } catch (const exception& e) {
-        cerr << "Invalid ID(s): " << e.what() << "\n";
+        cerr << "Invalid argument(s): " << e.what() << "\n";
+        return 1;
+    }
+
+    optional<TramRouteFinder> loaded;
+    const TramRouteFinder& finder = warm ? warm->finder : loaded.emplace(loadFinder(true, true));
+
+    QueryContext context(finder);
+    auto result = context.findReachable(startId, maxTime, maxCost);
+    cout << finder.isochroneToJson(result) << "\n";
+    return result.found ? 0 : 1;
+}
+
+// <startId> <targetId> <mode> [options...]
+int runRoute(int argc, char* argv[], const RouteService* warm = nullptr) {
+    RouteRequest request;
+    string error;
+    if (!parseRouteRequest(vector<string>(argv + 1, argv + argc), request, error)) {
+        cerr << error;
         return 1;
     }
 
-    string mode = argv[3];
-    // load stop_times for realtime only
-    string stopTimesContent;
-    if (mode == "realtime") {
-        stopTimesContent = readFileContent("gtfs/stop_times.txt");
-        if (stopTimesContent.empty()) {
-            cerr << "Failed to read stop_times.txt. Using empty data.\n";
+    // precomputed mode answers from routes.bin, else transfer_patterns.bin,
+    // else all_routes.json; only the binary stores need stop_times
+    PrecomputedFiles opened;
+    optional<TramRouteFinder> loaded;
+    if (!warm) {
+        if (request.mode == "precomputed") openPrecomputed(opened);
+        loaded.emplace(loadFinder(request.mode != "precomputed" || opened.hasStore || opened.hasPatterns,
+                                  request.options.engine == SearchEngine::AStar));
+        if (request.options.engine == SearchEngine::ALT && loaded->landmarkCount() == 0) {
+            loaded->buildLandmarks(TramRouteFinder::DEFAULT_LANDMARKS);
         }
     }
+    const TramRouteFinder& finder = warm ? warm->finder : *loaded;
+    const PrecomputedFiles& files = warm ? warm->files : opened;
+
+    QueryContext context(finder);
+    string out, err;
+    int status = answerRoute(context, files, request, out, err);
+    cout << out;
+    cerr << err;
+    return status;
+}
+
+// Options of serve and http
+struct ServiceOptions {
+    size_t cacheMb = 64, hotRoutes = 4096;
+    int workers = 0; // one per core
+    int port = 3001; // http only
+};
+
+static bool parseServiceOptions(int argc, char* argv[], bool withPort, ServiceOptions& options) {
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        try {
+            if (arg.rfind("--cache-mb=", 0) == 0) options.cacheMb = stoul(arg.substr(11));
+            else if (arg.rfind("--hot-routes=", 0) == 0) options.hotRoutes = stoul(arg.substr(13));
+            else if (arg.rfind("--workers=", 0) == 0) options.workers = stoi(arg.substr(10));
+            else if (withPort && arg.rfind("--port=", 0) == 0) options.port = stoi(arg.substr(7));
+            else { cerr << "Unknown option: " << arg << "\n"; return false; }
+        } catch (const exception& e) {
+            cerr << "Invalid option " << arg << ": " << e.what() << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The RouteService of serve and http, or null after reporting why it
+// cannot be loaded
+static unique_ptr<RouteService> startService(const ServiceOptions& options) {
+    try {
+        return make_unique<RouteService>(options.cacheMb, options.hotRoutes);
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return nullptr;
+    }
+}
+
+// serve [--cache-mb=N] [--hot-routes=N] [--workers=N]
+// Answers queries read from stdin until it closes, one per line: "<id>
+// <startId> <targetId> <mode> [options...]" as for the one-shot CLI, or
+// "<id> stats" for the cache and tier counters as JSON. Each answer is
+// "<id> <status> <length>\n" followed by length bytes, what the one-shot
+// CLI would print (stdout, then stderr) with status its exit code. Queries
+// run on a QueryExecutor of one pinned worker per core (--workers=N to
+// choose) sharing one RouteService, so answers come as they are ready,
+// not in request order.
+int runServe(int argc, char* argv[]) {
+    ServiceOptions options;
+    if (!parseServiceOptions(argc, argv, false, options)) return 1;
+    unique_ptr<RouteService> started = startService(options);
+    if (!started) return 1;
+    RouteService& service = *started;
+
+    // Answers are written whole under output; the last writer of a burst
+    // flushes, so answers ready together leave in one write
+    mutex output;
+    atomic<int> writers{0};
+    auto serve = [&](QueryContext& context, const string& line) {
+        istringstream fields(line);
+        string id;
+        vector<string> args;
+        fields >> id;
+        for (string arg; fields >> arg;) args.push_back(arg);
+
+        int status = 0;
+        string answer;
+        if (args.size() == 1 && args[0] == "stats") {
+            answer = service.stats();
+        } else if (args.size() < 3) {
+            status = 1;
+            answer = "Invalid request: " + line + "\n";
+        } else {
+            status = service.answer(context, args, answer);
+        }
+
+        writers++;
+        lock_guard<mutex> lock(output);
+        cout << id << " " << status << " " << answer.size() << "\n";
+        cout.write(answer.data(), answer.size());
+        if (--writers == 0) cout.flush();
+    };
+
+    // destroyed before returning, once every query read is answered
+    QueryExecutor<QueryContext> executor(options.workers, true, service.finder);
+    string line;
+    while (getline(cin, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        executor.submit([&serve, line](QueryContext& context) { serve(context, line); });
+    }
+    return 0;
+}
 
-    map<string,int> linePrices = {{"B1",5},{"B2",5},{"Y1",10},{"Y2",10}};
-    TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimesContent);
+// http [--port=3001] [--cache-mb=N] [--hot-routes=N] [--workers=N]
+// Serves GET /getPath?start=&end=&mode=[&k=] and GET /routeCacheStats
+// like the Go server, without it: an HttpServer with one event loop per
+// core (--workers=N to choose), each answering its connections from the
+// shared RouteService. Runs until SIGINT or SIGTERM.
+int runHttp(int argc, char* argv[]) {
+    ServiceOptions options;
+    if (!parseServiceOptions(argc, argv, true, options)) return 1;
+    unique_ptr<RouteService> started = startService(options);
+    if (!started) return 1;
+    RouteService& service = *started;
 
-    if (mode == "realtime") {
-        auto result = finder.findRoute(startId, targetId);
-        if (!result.found) {
-            cout << "{\"found\":false,\"error\":\"" << result.error << "\"}\n";
+    // taken by sigwait below, in every thread started from here on
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    const char* text = "text/plain; charset=utf-8";
+    auto handle = [&](const HttpRequest& request, HttpResponse& response, QueryContext& context) {
+        if (request.path != "/getPath" && request.path != "/routeCacheStats") {
+            response = {404, text, "404 page not found\n"};
+        } else if (request.method != "GET") {
+            response = {405, text, "Method Not Allowed\n"};
+        } else if (request.path == "/routeCacheStats") {
+            response.body = service.stats();
+        } else {
+            string_view start = request.param("start"), end = request.param("end"), mode = request.param("mode"),
+                        k = request.param("k");
+            if (start.empty() || end.empty() || mode.empty()) {
+                response = {400, text, "missing start, end or mode param\n"};
+                return;
+            }
+            vector<string> args{string(start), string(end), string(mode)};
+            if (!k.empty()) {
+                if (k.find_first_not_of("0123456789") != string_view::npos || k.size() > 9 || stoi(string(k)) < 1) {
+                    response = {400, text, "k must be a positive integer\n"};
+                    return;
+                }
+                args.push_back("--k=" + string(k));
+            }
+            int status = service.answer(context, args, response.body);
+            if (status != 0) {
+                response = {500, text, "routing binary failed: exit status " + to_string(status) + "\noutput:\n" +
+                                       response.body + "\n"};
+            }
+        }
+    };
+
+    try {
+        HttpServer<QueryContext> server(options.port, options.workers, handle, service.finder);
+        cerr << "Serving on port " << server.port() << "\n";
+        int signal;
+        sigwait(&signals, &signal);
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// The one-shot command in args (a route query, batch or isochrone, without
+// the program name), run on warm
+static int runCommand(const vector<string>& args, const RouteService& warm) {
+    vector<char*> argv = {(char*)"routing"};
+    for (const string& arg : args) argv.push_back((char*)arg.c_str());
+    argv.push_back(nullptr);
+    int argc = argv.size() - 1;
+    if (argc >= 2 && args[0] == "batch") return runBatch(argc, argv.data(), &warm);
+    if (argc >= 2 && args[0] == "isochrone") return runIsochrone(argc, argv.data(), &warm);
+    if (argc < 4) {
+        cerr << "Invalid request: expected <startId> <targetId> <mode>, batch or isochrone\n";
+        return 1;
+    }
+    return runRoute(argc, argv.data(), &warm);
+}
+
+// Runs the request read from connection in a zygote's child and writes
+// back its answer; the exit status of the child
+static int answerZygoteRequest(int connection, const RouteService& warm) {
+    string request;
+    char buffer[1 << 16];
+    for (ssize_t got; (got = read(connection, buffer, sizeof buffer)) != 0;) {
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) return 1;
+        request.append(buffer, got);
+    }
+    size_t lineEnd = min(request.find('\n'), request.size());
+    istringstream words(request.substr(0, lineEnd));
+    vector<string> args;
+    for (string word; words >> word;) args.push_back(word);
+
+    istringstream input(request.substr(min(lineEnd + 1, request.size())));
+    ostringstream out, err;
+    cin.rdbuf(input.rdbuf());
+    cout.rdbuf(out.rdbuf());
+    cerr.rdbuf(err.rdbuf());
+    int status;
+    try {
+        status = runCommand(args, warm);
+    } catch (const exception& e) {
+        err << e.what() << "\n";
+        status = 1;
+    }
+
+    string answer = out.str(), errors = err.str();
+    answer = to_string(status) + " " + to_string(answer.size()) + " " + to_string(errors.size()) + "\n" + answer + errors;
+    for (size_t sent = 0; sent < answer.size();) {
+        ssize_t written = write(connection, answer.data() + sent, answer.size() - sent);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return 1;
+        sent += written;
+    }
+    return 0;
+}
+
+// zygote [--socket=path] [--children=N]
+// Loads the network and precomputed files once, like serve, then forks a
+// child per connection on the Unix socket at path (/tmp/tram_routing.sock
+// by default, reachable by this user only) that runs one one-shot command
+// on them: children inherit the loaded network through copy-on-write
+// instead of loading it from disk. A request is a line of the CLI's
+// arguments, e.g. "isochrone 316823148 30 20" or "batch -
+// --format=ndjson", followed by the command's stdin up to the client's
+// shutdown of its side; the answer is "<status> <stdoutLength>
+// <stderrLength>\n", then the command's stdout and stderr. At most N
+// children (twice the cores by default) run at once; further connections
+// wait in the socket's backlog until one exits.
+// Prints "ready" once it accepts connections and stops on SIGINT or
+// SIGTERM, or when stdin is a pipe and its writer closes it.
+int runZygote(int argc, char* argv[]) {
+    ServiceOptions options;
+    options.cacheMb = options.hotRoutes = 0; // answers are not kept across children
+    string socketPath = "/tmp/tram_routing.sock";
+    int maxChildren = 2 * max(1u, thread::hardware_concurrency());
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        try {
+            if (arg.rfind("--socket=", 0) == 0) socketPath = arg.substr(9);
+            else if (arg.rfind("--children=", 0) == 0) maxChildren = max(1, stoi(arg.substr(11)));
+            else { cerr << "Unknown option: " << arg << "\n"; return 1; }
+        } catch (const exception& e) {
+            cerr << "Invalid option " << arg << ": " << e.what() << "\n";
             return 1;
         }
-        cout << finder.resultToJson(result) << "\n";
     }
-    else if (mode == "precomputed") {
-        // all_routes.json must be keyed by ID strings
-        cout << finder.findPrecomputedRoute(startId, targetId, "all_routes.json") << "\n";
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof address.sun_path) {
+        cerr << "Socket path too long: " << socketPath << "\n";
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    unique_ptr<RouteService> started = startService(options);
+    if (!started) return 1;
+    const RouteService& service = *started;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socketPath.c_str());
+    mode_t previousMask = umask(0177); // the socket is created 0600
+    bool bound = listener >= 0 && bind(listener, (sockaddr*)&address, sizeof address) == 0;
+    umask(previousMask);
+    if (!bound || listen(listener, SOMAXCONN) != 0) {
+        cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << "\n";
+        return 1;
     }
-    else {
-        cerr << "Unknown mode: " << mode << "\n";
+
+    // SIGINT and SIGTERM stop it; SIGCHLD tells a child exited
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &signals, &previous);
+    int signalled = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (signalled < 0) {
+        cerr << "signalfd failed: " << strerror(errno) << "\n";
+        unlink(socketPath.c_str());
         return 1;
     }
+    struct stat input;
+    bool watchInput = fstat(STDIN_FILENO, &input) == 0 && S_ISFIFO(input.st_mode);
 
+    cout << "ready" << endl;
+    vector<pollfd> watched = {{listener, POLLIN, 0}, {signalled, POLLIN, 0}};
+    if (watchInput) watched.push_back({STDIN_FILENO, POLLIN, 0});
+    int children = 0;
+    bool stopping = false;
+    while (!stopping) {
+        // at the cap, connections wait in the backlog
+        watched[0].events = children < maxChildren ? POLLIN : 0;
+        if (poll(watched.data(), watched.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        signalfd_siginfo info;
+        while (read(signalled, &info, sizeof info) == sizeof info) {
+            if (info.ssi_signo != SIGCHLD) stopping = true;
+        }
+        while (waitpid(-1, nullptr, WNOHANG) > 0) children--;
+        char ignored[256];
+        if (watchInput && watched[2].revents && read(STDIN_FILENO, ignored, sizeof ignored) <= 0) stopping = true;
+        if (stopping || !(watched[0].revents & POLLIN)) continue;
+
+        int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) continue;
+        pid_t child = fork();
+        if (child == 0) {
+            close(listener);
+            close(signalled);
+            sigprocmask(SIG_SETMASK, &previous, nullptr);
+            _exit(answerZygoteRequest(connection, service));
+        }
+        if (child > 0) children++;
+        else cerr << "fork failed: " << strerror(errno) << "\n";
+        close(connection);
+    }
+    close(listener);
+    unlink(socketPath.c_str());
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    if (argc >= 2 && string(argv[1]) == "batch") return runBatch(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "isochrone") return runIsochrone(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "serve") return runServe(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "http") return runHttp(argc, argv);
+    if (argc >= 2 && string(argv[1]) == "zygote") return runZygote(argc, argv);
+
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <startId> <targetId> <type: realtime|precomputed|pareto|minTransfers|fastest|alternatives> [--max-bag=N] [--k=N] [--engine=unidirectional|bidirectional|astar|alt] [--stats]\n"
+             << "       " << argv[0] << " batch <pairsFile|-> [--format=ndjson|matrix] [--threads=N]\n"
+             << "       " << argv[0] << " isochrone <startId> <maxMinutes> <maxCost>\n"
+             << "       " << argv[0] << " serve [--cache-mb=N] [--hot-routes=N] [--workers=N]\n"
+             << "       " << argv[0] << " http [--port=3001] [--cache-mb=N] [--hot-routes=N] [--workers=N]\n"
+             << "       " << argv[0] << " zygote [--socket=path] [--children=N]\n";
+        return 1;
+    }
+
+    return runRoute(argc, argv);
+}
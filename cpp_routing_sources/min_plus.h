@@ -0,0 +1,118 @@
+#pragma once
+#include <bits/stdc++.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+using namespace std;
+
+// Lexicographic (cost, time) weights packed into one integer so that the
+// min-plus semiring works on plain adds and compares: cost in the high 32
+// bits, time in the low 32 bits.
+typedef int64_t PathKey;
+constexpr PathKey KEY_INF = (PathKey)1 << 61;
+
+inline PathKey makeKey(int cost, int time) { return ((PathKey)cost << 32) | (uint32_t)time; }
+inline int keyCost(PathKey key) { return (int)(key >> 32); }
+inline int keyTime(PathKey key) { return (int)(key & 0xffffffff); }
+
+constexpr int MIN_PLUS_BLOCK = 64;
+
+// c[i][j] = min(c[i][j], a[i][k] + b[k][j]) over one block; rows are stride
+// apart. a may alias c and b (the Floyd-Warshall diagonal and panel steps).
+static void minPlusBlockScalar(PathKey *c, const PathKey *a, const PathKey *b, int stride, int rows, int cols, int depth)
+{
+    for (int k = 0; k < depth; k++)
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            PathKey aik = a[(size_t)i * stride + k];
+            if (aik >= KEY_INF) continue;
+            PathKey *ci = c + (size_t)i * stride;
+            const PathKey *bk = b + (size_t)k * stride;
+            for (int j = 0; j < cols; j++) ci[j] = min(ci[j], aik + bk[j]);
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static void minPlusBlockAvx2(PathKey *c, const PathKey *a, const PathKey *b, int stride, int rows, int cols, int depth)
+{
+    for (int k = 0; k < depth; k++)
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            PathKey aik = a[(size_t)i * stride + k];
+            if (aik >= KEY_INF) continue;
+            PathKey *ci = c + (size_t)i * stride;
+            const PathKey *bk = b + (size_t)k * stride;
+            const __m256i va = _mm256_set1_epi64x(aik);
+            int j = 0;
+            for (; j + 4 <= cols; j += 4)
+            {
+                __m256i sum = _mm256_add_epi64(va, _mm256_loadu_si256((const __m256i *)(bk + j)));
+                __m256i cur = _mm256_loadu_si256((const __m256i *)(ci + j));
+                __m256i better = _mm256_cmpgt_epi64(cur, sum);
+                _mm256_storeu_si256((__m256i *)(ci + j), _mm256_blendv_epi8(cur, sum, better));
+            }
+            for (; j < cols; j++) ci[j] = min(ci[j], aik + bk[j]);
+        }
+    }
+}
+#endif
+
+inline void minPlusBlock(PathKey *c, const PathKey *a, const PathKey *b, int stride, int rows, int cols, int depth)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2)
+    {
+        minPlusBlockAvx2(c, a, b, stride, rows, cols, depth);
+        return;
+    }
+#endif
+    minPlusBlockScalar(c, a, b, stride, rows, cols, depth);
+}
+
+// Blocked Floyd-Warshall over an n x n row-major matrix of PathKeys. Each
+// round relaxes the diagonal block, then its row and column panels, then
+// every remaining block; the last phase is split across threads.
+inline void floydWarshall(vector<PathKey> &d, int n, int threads = 0)
+{
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    const int bs = MIN_PLUS_BLOCK;
+    int blocks = (n + bs - 1) / bs;
+    auto at = [&](int bi, int bj) { return d.data() + (size_t)bi * bs * n + (size_t)bj * bs; };
+    auto extent = [&](int b) { return min(bs, n - b * bs); };
+
+    for (int kb = 0; kb < blocks; kb++)
+    {
+        int kd = extent(kb);
+        PathKey *diag = at(kb, kb);
+        minPlusBlock(diag, diag, diag, n, kd, kd, kd);
+
+        for (int b = 0; b < blocks; b++)
+        {
+            if (b == kb) continue;
+            minPlusBlock(at(kb, b), diag, at(kb, b), n, kd, extent(b), kd);
+            minPlusBlock(at(b, kb), at(b, kb), diag, n, extent(b), kd, kd);
+        }
+
+        atomic<int> nextRow{0};
+        auto worker = [&]()
+        {
+            for (int bi; (bi = nextRow++) < blocks;)
+            {
+                if (bi == kb) continue;
+                for (int bj = 0; bj < blocks; bj++)
+                {
+                    if (bj == kb) continue;
+                    minPlusBlock(at(bi, bj), at(bi, kb), at(kb, bj), n, extent(bi), extent(bj), kd);
+                }
+            }
+        };
+        vector<thread> pool;
+        for (int t = 1; t < min(threads, blocks); t++) pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool) t.join();
+    }
+}
@@ -1,10 +1,21 @@
 #include <fstream>
 #include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "json.hpp"
 #include "helper.h"
 using json = nlohmann::json;
 
-void precomputeAllRoutes(const string& outputFilename = "all_routes.json") {
+// Checkpoint key: the kind of output and the network it is computed from
+static uint64_t checkpointKey(const string& kind, const TramRouteFinder& finder) {
+    string bytes = kind + "\n" + finder.compile();
+    return fingerprintBytes(bytes.data(), bytes.size());
+}
+
+// Every pair's findRoute JSON, one source at a time. Finished sources go to
+// <output>.partial as they complete, so with resume a crashed run skips
+// them; the output is written by rename once all are done.
+void precomputeAllRoutes(const string& outputFilename = "all_routes.json", bool resume = false) {
 
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
@@ -13,9 +24,6 @@ void precomputeAllRoutes(const string& outputFilename = "all_routes.json") {
     if (stopTimesContent.empty()) {
         cerr << "Failed to read stop_times.csv. Using empty data." << endl;
     }
-    map<string, int> linePrices = {
-        {"B1", 5}, {"B2", 5}, {"Y1", 10}, {"Y2", 10}
-    };
 
     // Create a set of all unique station IDs
     set<long long> allStations;
@@ -24,20 +32,25 @@ void precomputeAllRoutes(const string& outputFilename = "all_routes.json") {
             allStations.insert(stationId);
         }
     }
+    vector<long long> sources(allStations.begin(), allStations.end());
 
     // Initialize the route finder
     TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimesContent);
+    SourceCheckpoint checkpoint(outputFilename + ".partial", checkpointKey("all_routes.json", finder), sources.size(), resume);
 
     json allRoutes;
 
     // Process each pair of stations
-    for (auto srcIt = allStations.begin(); srcIt != allStations.end(); ++srcIt) {
-        long long srcId = *srcIt;
+    for (size_t i = 0; i < sources.size(); i++) {
+        long long srcId = sources[i];
+        auto done = checkpoint.finished().find(i);
+        if (done != checkpoint.finished().end()) {
+            allRoutes[to_string(srcId)] = json::parse(done->second);
+            continue;
+        }
         json srcRoutes;
         
-        for (auto destIt = allStations.begin(); destIt != allStations.end(); ++destIt) {
-            long long destId = *destIt;
-            
+        for (long long destId : sources) {
             // Skip if source and destination are the same
             if (srcId == destId) continue;
             
@@ -50,21 +63,274 @@ void precomputeAllRoutes(const string& outputFilename = "all_routes.json") {
         }
         
         // Add all routes from this source station to the main object
-        allRoutes[to_string(srcId)] = srcRoutes;
+        checkpoint.add(i, srcRoutes.dump());
+        allRoutes[to_string(srcId)] = move(srcRoutes);
     }
+    checkpoint.close();
 
     // Write the complete JSON to file
-    ofstream outFile(outputFilename);
+    if (writeFileAtomically(outputFilename, allRoutes.dump(2))) {
+        checkpoint.discard();
+        cout << "Successfully precomputed all routes to " << outputFilename << endl;
+    } else {
+        cerr << "Failed to open output file: " << outputFilename << endl;
+    }
+}
+
+// Writes the station x station (cost, time) matrix in the TRMX layout of
+// TramRouteFinder::batchToMatrix instead of per-pair route JSON.
+void exportTravelMatrix(const string& outputFilename, int threads) {
+    string stopTimesContent = readFileContent("gtfs/stop_times.txt");
+    if (stopTimesContent.empty()) {
+        cerr << "Failed to read stop_times.csv. Using empty data." << endl;
+    }
+    TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimesContent);
+
+    vector<long long> ids = finder.stationIds();
+    string bytes = TramRouteFinder::travelMatrixBytes(ids, ids, finder.allPairsMatrix(threads));
+
+    ofstream outFile(outputFilename, ios::binary);
     if (outFile.is_open()) {
-        outFile << allRoutes.dump(2);
+        outFile.write(bytes.data(), bytes.size());
         outFile.close();
-        cout << "Successfully precomputed all routes to " << outputFilename << endl;
+        cout << "Successfully wrote " << ids.size() << "x" << ids.size() << " travel matrix to " << outputFilename << endl;
+    } else {
+        cerr << "Failed to open output file: " << outputFilename << endl;
+    }
+}
+
+// Writes the compiled network (see TramRouteFinder::compile) with ride
+// times, coordinates, the ALT landmark tables and the contraction
+// hierarchy, for main.cpp to load.
+void compileNetwork(const string& outputFilename, int landmarkCount, int threads) {
+    string stopTimesContent = readFileContent("gtfs/stop_times.txt");
+    if (stopTimesContent.empty()) {
+        cerr << "Failed to read stop_times.csv. Using empty data." << endl;
+    }
+    TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimesContent);
+    finder.loadStopCoordinates(readFileContent("gtfs/stops.txt"));
+    finder.buildLandmarks(landmarkCount);
+    finder.buildContractionHierarchy(threads);
+
+    string bytes = finder.compile();
+    ofstream outFile(outputFilename, ios::binary);
+    if (outFile.is_open()) {
+        outFile.write(bytes.data(), bytes.size());
+        outFile.close();
+        cout << "Successfully compiled " << finder.stationIds().size() << " stations and " << finder.landmarkCount()
+             << " landmarks to " << outputFilename << " (" << bytes.size() << " bytes)" << endl;
     } else {
         cerr << "Failed to open output file: " << outputFilename << endl;
     }
 }
 
-int main() {
-    precomputeAllRoutes();
+// Writes the transfer patterns of every pair (see TransferPatterns), from
+// which precomputed mode rebuilds the routes all_routes.json would hold.
+void exportTransferPatterns(const string& outputFilename, int threads) {
+    string stopTimesContent = readFileContent("gtfs/stop_times.txt");
+    if (stopTimesContent.empty()) {
+        cerr << "Failed to read stop_times.csv. Using empty data." << endl;
+    }
+    TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimesContent);
+
+    TransferPatterns patterns = finder.buildTransferPatterns(threads);
+    string bytes = patterns.serialize();
+    ofstream outFile(outputFilename, ios::binary);
+    if (outFile.is_open()) {
+        outFile.write(bytes.data(), bytes.size());
+        outFile.close();
+        cout << "Successfully wrote " << patterns.nodes.size() << " transfer pattern nodes for " << patterns.stationIds.size()
+             << " stations to " << outputFilename << " (" << bytes.size() << " bytes)" << endl;
+    } else {
+        cerr << "Failed to open output file: " << outputFilename << endl;
+    }
+}
+
+// The network of a route store: the compiled one in networkFile when given,
+// else the built-in lines; nullopt when networkFile cannot be read
+static optional<TramRouteFinder> storeNetwork(const string& networkFile) {
+    if (networkFile.empty()) {
+        return TramRouteFinder(trips, tripNames, linePrices, stationNames, readFileContent("gtfs/stop_times.txt"));
+    }
+    string compiled = readBinaryFile(networkFile);
+    if (compiled.empty()) {
+        cerr << "Failed to read " << networkFile << endl;
+        return nullopt;
+    }
+    return TramRouteFinder::fromCompiled(compiled);
+}
+
+// Writes every optimal route as line segments (see RouteStore), which
+// precomputed mode lays out on the trip arrays when answering, and next to
+// it what each source's routes depend on (routes.bin.deps). With update,
+// sources a network change cannot affect keep their blocks from the
+// existing store. A full build checkpoints finished sources to
+// <output>.partial, which resume picks up after a crash. Both files are
+// replaced by rename.
+void exportRouteStore(const string& outputFilename, const string& networkFile, bool update, bool resume, int threads) {
+    optional<TramRouteFinder> network = storeNetwork(networkFile);
+    if (!network) return;
+    const TramRouteFinder& finder = *network;
+    size_t stations = finder.stationIds().size();
+    string depsFilename = outputFilename + ".deps";
+
+    auto started = chrono::steady_clock::now();
+    RouteDependencies deps;
+    string bytes;
+    int recomputed = stations;
+    if (update) {
+        try {
+            RouteStore old;
+            old.open(outputFilename);
+            bytes = finder.updateRouteStore(old, RouteDependencies::parse(readBinaryFile(depsFilename)), threads, &deps, &recomputed);
+        } catch (const exception& e) {
+            cerr << "Cannot update " << outputFilename << " (" << e.what() << "), rebuilding it" << endl;
+        }
+    }
+    unique_ptr<SourceCheckpoint> checkpoint;
+    if (bytes.empty()) {
+        checkpoint = make_unique<SourceCheckpoint>(outputFilename + ".partial", checkpointKey("routes.bin", finder), stations, resume);
+        bytes = finder.buildRouteStore(threads, &deps, checkpoint.get());
+        checkpoint->close();
+    }
+    double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+    if (writeFileAtomically(outputFilename, bytes) && writeFileAtomically(depsFilename, deps.serialize())) {
+        if (checkpoint) checkpoint->discard();
+        cout << "Successfully wrote routes of " << stations << " stations to " << outputFilename << " (" << bytes.size()
+             << " bytes), recomputed " << recomputed << " sources in " << (long long)elapsedMs << " ms" << endl;
+    } else {
+        cerr << "Failed to write " << outputFilename << endl;
+    }
+}
+
+// Shard i of N of a route store, <output>.shard-<i>-of-<N>: a checkpoint
+// file (see SourceCheckpoint) holding the sources of the i-th of N equal
+// index ranges
+static string shardFilename(const string& outputFilename, int shard, int shards) {
+    return outputFilename + ".shard-" + to_string(shard) + "-of-" + to_string(shards);
+}
+
+// Builds shard i/N of the route store, on this or another machine; resume
+// keeps the sources an interrupted run of the same shard finished
+bool exportRouteStoreShard(const string& outputFilename, const string& networkFile, int shard, int shards, bool resume, int threads) {
+    optional<TramRouteFinder> network = storeNetwork(networkFile);
+    if (!network) return false;
+    int stations = network->stationIds().size();
+    int begin = (long long)stations * shard / shards, end = (long long)stations * (shard + 1) / shards;
+    string filename = shardFilename(outputFilename, shard, shards);
+    string label = "shard " + to_string(shard) + "/" + to_string(shards) + ": ";
+
+    SourceCheckpoint checkpoint(filename, checkpointKey("routes.bin", *network), end - begin, resume, label);
+    network->buildRouteStoreShard(begin, end, threads, checkpoint);
+    checkpoint.close();
+    cout << "Successfully wrote sources " << begin << ".." << end - 1 << " of " << stations << " to " << filename << endl;
+    return true;
+}
+
+// Assembles the store and routes.bin.deps from the N shard files, which
+// must all be built on the same network; the result equals exportRouteStore
+bool mergeRouteStoreShards(const string& outputFilename, const string& networkFile, int shards) {
+    optional<TramRouteFinder> network = storeNetwork(networkFile);
+    if (!network) return false;
+    uint64_t key = checkpointKey("routes.bin", *network);
+    map<int, string> sources;
+    RouteDependencies deps;
+    string bytes;
+    try {
+        for (int shard = 0; shard < shards; shard++) sources.merge(SourceCheckpoint::read(shardFilename(outputFilename, shard, shards), key));
+        bytes = network->mergeRouteStore(sources, &deps);
+    } catch (const exception& e) {
+        cerr << "Cannot merge " << outputFilename << ": " << e.what() << endl;
+        return false;
+    }
+    if (!writeFileAtomically(outputFilename, bytes) || !writeFileAtomically(outputFilename + ".deps", deps.serialize())) {
+        cerr << "Failed to write " << outputFilename << endl;
+        return false;
+    }
+    cout << "Successfully merged " << shards << " shards into " << outputFilename << " (" << bytes.size() << " bytes)" << endl;
+    return true;
+}
+
+// Local stand-in for a distributed build: forks one worker process per
+// shard, waits for all of them and merges. Shard files are removed after a
+// successful merge and kept otherwise, for resume. False if a worker or
+// the merge failed.
+bool runRouteStoreWorkers(const string& outputFilename, const string& networkFile, int workers, bool resume, int threads) {
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency() / workers);
+    auto started = chrono::steady_clock::now();
+    cout.flush();
+    vector<pid_t> children;
+    for (int shard = 0; shard < workers; shard++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool ok = false;
+            try {
+                ok = exportRouteStoreShard(outputFilename, networkFile, shard, workers, resume, threads);
+            } catch (const exception& e) {
+                cerr << "Shard " << shard << " failed: " << e.what() << endl;
+            }
+            cout.flush();
+            _exit(ok ? 0 : 1);
+        }
+        if (pid < 0) cerr << "Failed to start worker " << shard << endl;
+        children.push_back(pid);
+    }
+    bool allDone = true;
+    for (pid_t pid : children) {
+        int status = 0;
+        allDone = pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && allDone;
+    }
+    if (!allDone) {
+        cerr << "Some workers failed; rerun with --resume to finish their shards" << endl;
+        return false;
+    }
+    if (!mergeRouteStoreShards(outputFilename, networkFile, workers)) return false;
+    for (int shard = 0; shard < workers; shard++) filesystem::remove(shardFilename(outputFilename, shard, workers));
+    double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    cout << "Built " << outputFilename << " with " << workers << " workers in " << (long long)elapsedMs << " ms" << endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string matrixFile, compiledFile, patternsFile, storeFile, networkFile;
+    bool update = false, resume = false;
+    int threads = 0, shard = -1, shards = 0, mergeShards = 0, workers = 0;
+    int landmarkCount = TramRouteFinder::DEFAULT_LANDMARKS;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--matrix" && i + 1 < argc) matrixFile = argv[++i];
+        else if (arg == "--compile" && i + 1 < argc) compiledFile = argv[++i];
+        else if (arg == "--patterns" && i + 1 < argc) patternsFile = argv[++i];
+        else if (arg == "--store" && i + 1 < argc) storeFile = argv[++i];
+        else if (arg == "--network" && i + 1 < argc) networkFile = argv[++i];
+        else if (arg == "--update") update = true;
+        else if (arg == "--resume") resume = true;
+        else if (arg == "--shard" && i + 1 < argc && sscanf(argv[i + 1], "%d/%d", &shard, &shards) == 2 && shard >= 0 && shard < shards) i++;
+        else if (arg == "--merge" && i + 1 < argc && (mergeShards = atoi(argv[i + 1])) > 0) i++;
+        else if (arg == "--workers" && i + 1 < argc && (workers = atoi(argv[i + 1])) > 0) i++;
+        else if (arg.rfind("--threads=", 0) == 0) threads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--landmarks=", 0) == 0) landmarkCount = atoi(arg.c_str() + 12);
+        else {
+            cerr << "Usage: " << argv[0] << " [--resume]" << endl
+                 << "       " << argv[0] << " --matrix <out.bin> [--threads=N]" << endl
+                 << "       " << argv[0] << " --compile <network.bin> [--landmarks=K] [--threads=N]" << endl
+                 << "       " << argv[0] << " --patterns <transfer_patterns.bin> [--threads=N]" << endl
+                 << "       " << argv[0] << " --store <routes.bin> [--update | --resume] [--network <network.bin>] [--threads=N]" << endl
+                 << "       " << argv[0] << " --store <routes.bin> --shard <i>/<N> [--resume] [--network <network.bin>] [--threads=N]" << endl
+                 << "       " << argv[0] << " --store <routes.bin> --merge <N> [--network <network.bin>]" << endl
+                 << "       " << argv[0] << " --store <routes.bin> --workers <N> [--resume] [--network <network.bin>] [--threads=N]" << endl;
+            return 1;
+        }
+    }
+
+    if (!compiledFile.empty()) compileNetwork(compiledFile, landmarkCount, threads);
+    else if (!patternsFile.empty()) exportTransferPatterns(patternsFile, threads);
+    else if (!storeFile.empty() && shards) return exportRouteStoreShard(storeFile, networkFile, shard, shards, resume, threads) ? 0 : 1;
+    else if (!storeFile.empty() && mergeShards) return mergeRouteStoreShards(storeFile, networkFile, mergeShards) ? 0 : 1;
+    else if (!storeFile.empty() && workers) return runRouteStoreWorkers(storeFile, networkFile, workers, resume, threads) ? 0 : 1;
+    else if (!storeFile.empty()) exportRouteStore(storeFile, networkFile, update, resume, threads);
+    else if (!matrixFile.empty()) exportTravelMatrix(matrixFile, threads);
+    else precomputeAllRoutes("all_routes.json", resume);
     return 0;
 }
\ No newline at end of file
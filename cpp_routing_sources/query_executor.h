@@ -0,0 +1,230 @@
+#pragma once
+#include <bits/stdc++.h>
+#include <pthread.h>
+#include <sched.h>
+using namespace std;
+
+// The cores this process may run on, in order
+inline vector<int> allowedCores()
+{
+    vector<int> cores;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int core = 0; core < CPU_SETSIZE; core++)
+            if (CPU_ISSET(core, &set)) cores.push_back(core);
+    if (cores.empty()) cores.push_back(0);
+    return cores;
+}
+
+// Keeps the calling thread on core
+inline void pinToCore(int core)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Starts count threads, the i-th pinned (when pin is set) to the allowed
+// cores in turn, building a Workspace from args on its own thread and then
+// running body(i, workspace). Returns once every workspace is built, as
+// they refer to args, which need only live until then.
+template <class Workspace, class Body, class... Args>
+vector<thread> spawnWorkers(int count, bool pin, Body body, const Args &...args)
+{
+    vector<int> cores = allowedCores();
+    atomic<int> started{0};
+    vector<thread> threads;
+    for (int i = 0; i < count; i++)
+        threads.emplace_back([i, pin, core = cores[i % cores.size()], &started, body, &args...]() {
+            if (pin) pinToCore(core);
+            Workspace workspace(args...);
+            started.fetch_add(1);
+            body(i, workspace);
+        });
+    while (started.load() < count) this_thread::yield();
+    return threads;
+}
+
+// Bounded lock-free queue of tasks (Vyukov's ring): each cell carries a
+// sequence number telling producers and consumers whose turn it is, so a
+// push or pop is one compare-and-swap on the head or tail. Any thread may
+// push or pop, which lets idle workers steal from it.
+template <class T>
+class TaskQueue
+{
+public:
+    explicit TaskQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        mask = size - 1;
+        cells = make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    // false when the queue is full
+    bool tryPush(T &value)
+    {
+        size_t at = tail.load(memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells[at & mask];
+            intptr_t lag = (intptr_t)cell.sequence.load(memory_order_acquire) - (intptr_t)at;
+            if (lag == 0 && tail.compare_exchange_weak(at, at + 1, memory_order_relaxed))
+            {
+                cell.value = move(value);
+                cell.sequence.store(at + 1, memory_order_release);
+                return true;
+            }
+            if (lag < 0) return false;
+            if (lag > 0) at = tail.load(memory_order_relaxed);
+        }
+    }
+
+    // false when the queue is empty
+    bool tryPop(T &value)
+    {
+        size_t at = head.load(memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells[at & mask];
+            intptr_t lag = (intptr_t)cell.sequence.load(memory_order_acquire) - (intptr_t)(at + 1);
+            if (lag == 0 && head.compare_exchange_weak(at, at + 1, memory_order_relaxed))
+            {
+                value = move(cell.value);
+                cell.sequence.store(at + mask + 1, memory_order_release);
+                return true;
+            }
+            if (lag < 0) return false;
+            if (lag > 0) at = head.load(memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Cell
+    {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    size_t mask;
+    unique_ptr<Cell[]> cells;
+    alignas(64) atomic<size_t> tail{0};
+    alignas(64) atomic<size_t> head{0};
+};
+
+// Fixed pool of query workers, one per core and pinned to it. Each worker
+// owns a Workspace built on its own thread from the constructor's
+// arguments (e.g. a QueryContext and its search buffers) and a TaskQueue.
+// submit() spreads tasks round-robin over the queues; a worker whose queue
+// runs dry steals from the others before it spins and then sleeps until
+// more work arrives. The destructor runs every task already submitted.
+template <class Workspace>
+class QueryExecutor
+{
+public:
+    using Task = function<void(Workspace &)>;
+
+    static constexpr size_t QUEUE_CAPACITY = 1024;
+    static constexpr int IDLE_SPINS = 64;
+
+    // workers <= 0 means one per core the process may run on
+    template <class... Args>
+    explicit QueryExecutor(int workers, bool pin, const Args &...args)
+    {
+        if (workers <= 0) workers = allowedCores().size();
+        for (int i = 0; i < workers; i++) queues.push_back(make_unique<TaskQueue<Task>>(QUEUE_CAPACITY));
+        threads = spawnWorkers<Workspace>(workers, pin, [this](int i, Workspace &workspace) { run(i, workspace); }, args...);
+    }
+
+    QueryExecutor(const QueryExecutor &) = delete;
+    QueryExecutor &operator=(const QueryExecutor &) = delete;
+
+    ~QueryExecutor()
+    {
+        {
+            lock_guard<mutex> lock(parking);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &t : threads) t.join();
+    }
+
+    int workers() const { return threads.size(); }
+
+    // Queues task for some worker; waits while every queue is full
+    void submit(Task task)
+    {
+        size_t first = nextQueue.fetch_add(1, memory_order_relaxed);
+        for (size_t i = 0;; i++)
+        {
+            if (queues[(first + i) % queues.size()]->tryPush(task)) break;
+            if (i % queues.size() == queues.size() - 1) this_thread::yield();
+        }
+        pushes.fetch_add(1);
+        if (sleepers.load() > 0)
+        {
+            lock_guard<mutex> lock(parking);
+            wake.notify_one();
+        }
+    }
+
+private:
+    vector<unique_ptr<TaskQueue<Task>>> queues;
+    vector<thread> threads;
+    atomic<size_t> nextQueue{0};
+    atomic<uint64_t> pushes{0};
+    atomic<int> sleepers{0};
+    mutex parking;
+    condition_variable wake;
+    bool stopping = false; // guarded by parking
+
+    // Own queue first, then the others starting from the next worker
+    bool take(int worker, Task &task)
+    {
+        for (size_t i = 0; i < queues.size(); i++)
+            if (queues[(worker + i) % queues.size()]->tryPop(task)) return true;
+        return false;
+    }
+
+    void run(int worker, Workspace &workspace)
+    {
+        Task task;
+        for (int idle = 0;;)
+        {
+            if (take(worker, task))
+            {
+                task(workspace);
+                task = nullptr;
+                idle = 0;
+                continue;
+            }
+            if (++idle < IDLE_SPINS)
+            {
+                this_thread::yield();
+                continue;
+            }
+            unique_lock<mutex> lock(parking);
+            // a submit after this load either is seen by take() below or
+            // sees us asleep and wakes us
+            sleepers.fetch_add(1);
+            uint64_t seen = pushes.load();
+            bool more = take(worker, task);
+            if (!more && stopping)
+            {
+                sleepers.fetch_sub(1);
+                return;
+            }
+            if (!more) wake.wait(lock, [&]() { return stopping || pushes.load() != seen; });
+            sleepers.fetch_sub(1);
+            lock.unlock();
+            if (more)
+            {
+                task(workspace);
+                task = nullptr;
+            }
+            idle = 0;
+        }
+    }
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include <bits/stdc++.h>
+using namespace std;
+
+// Bounded cache of serialized responses keyed by request, for the few
+// station pairs most traffic asks for. Keys hash to one of a fixed number
+// of shards, each with its own lock, so concurrent lookups rarely meet.
+// Within a shard, entries sit in a ring swept by a CLOCK hand: a hit sets
+// the entry's reference bit, and the hand evicts the first entry whose bit
+// is clear, clearing bits as it passes. Capacity is in bytes of keys and
+// values, split evenly over the shards.
+class ResultCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+
+    explicit ResultCache(size_t capacityBytes, int shardCount = 16)
+        : shards(max(shardCount, 1)), shardCapacity(capacityBytes / max(shardCount, 1))
+    {
+    }
+
+    ResultCache(const ResultCache &) = delete;
+    ResultCache &operator=(const ResultCache &) = delete;
+
+    // Copies the value cached for key into value; false on a miss
+    bool get(const string &key, string &value)
+    {
+        Shard &shard = shardOf(key);
+        lock_guard<mutex> lock(shard.guard);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end())
+        {
+            shard.misses++;
+            return false;
+        }
+        Entry &entry = shard.ring[it->second];
+        entry.referenced = true;
+        value = entry.value;
+        shard.hits++;
+        return true;
+    }
+
+    // Caches value under key, evicting cold entries to make room; a value
+    // larger than a whole shard is not cached
+    void put(const string &key, const string &value)
+    {
+        Shard &shard = shardOf(key);
+        size_t size = key.size() + value.size();
+        if (size > shardCapacity) return;
+        lock_guard<mutex> lock(shard.guard);
+        auto it = shard.index.find(key);
+        size_t slot;
+        if (it != shard.index.end())
+        {
+            slot = it->second;
+            Entry &entry = shard.ring[slot];
+            shard.bytes = shard.bytes - entry.value.size() + value.size();
+            entry.value = value;
+            entry.referenced = true;
+        }
+        else
+        {
+            slot = shard.ring.size();
+            if (!shard.free.empty())
+            {
+                slot = shard.free.back();
+                shard.free.pop_back();
+            }
+            else shard.ring.emplace_back();
+            shard.ring[slot] = {key, value, true, true};
+            shard.index.emplace(key, slot);
+            shard.bytes += size;
+        }
+        // the entry just written is never the one evicted; it fits in a
+        // shard, so the others go first
+        while (shard.bytes > shardCapacity) evict(shard, slot);
+    }
+
+    // Counters summed over the shards
+    Stats stats() const
+    {
+        Stats total;
+        for (const Shard &shard : shards)
+        {
+            lock_guard<mutex> lock(shard.guard);
+            total.hits += shard.hits;
+            total.misses += shard.misses;
+            total.evictions += shard.evictions;
+            total.entries += shard.index.size();
+            total.bytes += shard.bytes;
+        }
+        return total;
+    }
+
+private:
+    struct Entry
+    {
+        string key;
+        string value;
+        bool referenced = false;
+        bool live = false;
+    };
+
+    struct Shard
+    {
+        mutable mutex guard;
+        unordered_map<string, size_t> index; // key -> slot in ring
+        vector<Entry> ring;
+        vector<size_t> free; // slots of evicted entries
+        size_t hand = 0;
+        size_t bytes = 0;
+        uint64_t hits = 0, misses = 0, evictions = 0;
+    };
+
+    vector<Shard> shards;
+    size_t shardCapacity;
+
+    Shard &shardOf(const string &key)
+    {
+        // the top bits, so the shard does not follow the index's buckets
+        uint64_t h = hash<string>()(key) * 0x9E3779B97F4A7C15ULL;
+        return shards[(h >> 32) % shards.size()];
+    }
+
+    // Advances the hand to the first live entry other than keep not
+    // referenced since the last sweep and drops it; the shard's lock is held
+    static void evict(Shard &shard, size_t keep)
+    {
+        for (;;)
+        {
+            if (shard.hand >= shard.ring.size()) shard.hand = 0;
+            Entry &entry = shard.ring[shard.hand++];
+            if (!entry.live || shard.hand - 1 == keep) continue;
+            if (entry.referenced)
+            {
+                entry.referenced = false;
+                continue;
+            }
+            shard.index.erase(entry.key);
+            shard.bytes -= entry.key.size() + entry.value.size();
+            shard.free.push_back(shard.hand - 1);
+            entry = Entry();
+            shard.evictions++;
+            return;
+        }
+    }
+};
@@ -0,0 +1,284 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "helper.h"
+#include "result_cache.h"
+#include "route_tiers.h"
+using namespace std;
+
+// Route queries answered as the routing CLI prints them, shared by the CLI,
+// its serve and http daemons and the librouting C API.
+
+// The compiled network written by `precompute --compile network.bin` when
+// present and built from the current lines and gtfs files, else the
+// built-in lines with ride times from gtfs/stop_times.txt and, if asked,
+// coordinates from gtfs/stops.txt.
+inline TramRouteFinder loadFinder(bool withStopTimes, bool withCoordinates)
+{
+    string compiled = readBinaryFile("network.bin");
+    string stopTimesContent = readFileContent("gtfs/stop_times.txt");
+    if (!compiled.empty())
+    {
+        try
+        {
+            TramRouteFinder finder = TramRouteFinder::fromCompiled(compiled);
+            if (finder.matchesSources(trips, tripNames, linePrices, stationNames, stopTimesContent, readFileContent("gtfs/stops.txt")))
+            {
+                return finder;
+            }
+            cerr << "Ignoring network.bin: built from other lines or gtfs files; rerun precompute --compile\n";
+        }
+        catch (const exception &e)
+        {
+            cerr << "Ignoring network.bin: " << e.what() << "\n";
+        }
+    }
+
+    if (!withStopTimes) stopTimesContent.clear();
+    else if (stopTimesContent.empty())
+    {
+        cerr << "Failed to read stop_times.txt. Using empty data.\n";
+    }
+    TramRouteFinder finder(trips, tripNames, linePrices, stationNames, stopTimesContent);
+    if (withCoordinates) finder.loadStopCoordinates(readFileContent("gtfs/stops.txt"));
+    return finder;
+}
+
+// A route query: <startId> <targetId> <mode> [options...]
+struct RouteRequest
+{
+    long long startId = 0, targetId = 0;
+    string mode;
+    RouteOptions options;
+};
+
+// Parses the arguments of a route query; false with the message for
+// stderr when they are invalid
+inline bool parseRouteRequest(const vector<string> &args, RouteRequest &request, string &error)
+{
+    try
+    {
+        request.startId  = stoll(args.at(0));
+        request.targetId = stoll(args.at(1));
+    }
+    catch (const exception &e)
+    {
+        error = string("Invalid ID(s): ") + e.what() + "\n";
+        return false;
+    }
+
+    request.mode = args.at(2);
+    RouteOptions &options = request.options;
+    options.pareto = request.mode == "pareto";
+    if (request.mode == "minTransfers") options.objective = RouteObjective::MinTransfers;
+    if (request.mode == "fastest") options.objective = RouteObjective::Fastest;
+    if (request.mode == "alternatives") options.alternatives = 3;
+    for (size_t i = 3; i < args.size(); i++)
+    {
+        const string &arg = args[i];
+        try
+        {
+            if (arg.rfind("--max-bag=", 0) == 0) options.maxBagSize = stoi(arg.substr(10));
+            else if (arg.rfind("--k=", 0) == 0) options.alternatives = stoi(arg.substr(4));
+            else if (arg == "--engine=unidirectional") options.engine = SearchEngine::Unidirectional;
+            else if (arg == "--engine=bidirectional") options.engine = SearchEngine::Bidirectional;
+            else if (arg == "--engine=astar") options.engine = SearchEngine::AStar;
+            else if (arg == "--engine=alt") options.engine = SearchEngine::ALT;
+            else if (arg == "--stats") options.reportStats = true;
+            else { error = "Unknown option: " + arg + "\n"; return false; }
+        }
+        catch (const exception &e)
+        {
+            error = "Invalid option " + arg + ": " + e.what() + "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The files precomputed mode answers from: routes.bin, else
+// transfer_patterns.bin, else all_routes.json
+struct PrecomputedFiles
+{
+    bool hasStore = false;
+    RouteStore store;
+    bool hasPatterns = false;
+    TransferPatterns patterns;
+    string error; // why the file in use cannot be read
+};
+
+inline void openPrecomputed(PrecomputedFiles &files)
+{
+    files.hasStore = ifstream("routes.bin").good();
+    if (files.hasStore)
+    {
+        try
+        {
+            files.store.open("routes.bin");
+        }
+        catch (const exception &e)
+        {
+            files.error = string("Invalid routes.bin: ") + e.what() + "\n";
+        }
+        return;
+    }
+    string patternBytes = readBinaryFile("transfer_patterns.bin");
+    files.hasPatterns = !patternBytes.empty();
+    if (!files.hasPatterns) return;
+    try
+    {
+        files.patterns = TransferPatterns::parse(patternBytes);
+    }
+    catch (const exception &e)
+    {
+        files.error = string("Invalid transfer_patterns.bin: ") + e.what() + "\n";
+    }
+}
+
+// Answers a route query as the CLI prints it: out for stdout, err for
+// stderr; returns the exit status
+inline int answerRoute(QueryContext &context, const PrecomputedFiles &files, const RouteRequest &request, string &out, string &err)
+{
+    const TramRouteFinder &finder = context.finder();
+    const string &mode = request.mode;
+    long long startId = request.startId, targetId = request.targetId;
+    if (mode == "realtime" || mode == "pareto" || mode == "minTransfers" || mode == "fastest" || mode == "alternatives")
+    {
+        auto result = context.findRoute(startId, targetId, request.options);
+        if (!result.found)
+        {
+            out = "{\"found\":false,\"error\":\"" + result.error + "\"}\n";
+            return 1;
+        }
+        out = finder.resultToJson(result) + "\n";
+    }
+    else if (mode == "precomputed" && !files.error.empty())
+    {
+        err = files.error;
+        return 1;
+    }
+    else if (mode == "precomputed" && files.hasStore)
+    {
+        try
+        {
+            if (!finder.matchesStore(files.store))
+            {
+                err = "routes.bin was built for a different network\n";
+                return 1;
+            }
+            out = finder.resultToJson(finder.findStoredRoute(startId, targetId, files.store)) + "\n";
+        }
+        catch (const exception &e)
+        {
+            err = string("Invalid routes.bin: ") + e.what() + "\n";
+            return 1;
+        }
+    }
+    else if (mode == "precomputed" && files.hasPatterns)
+    {
+        if (!finder.matchesPatterns(files.patterns))
+        {
+            err = "transfer_patterns.bin was built for a different network\n";
+            return 1;
+        }
+        out = finder.resultToJson(finder.findPatternRoute(startId, targetId, files.patterns)) + "\n";
+    }
+    else if (mode == "precomputed")
+    {
+        // all_routes.json must be keyed by ID strings
+        out = finder.findPrecomputedRoute(startId, targetId, "all_routes.json") + "\n";
+    }
+    else
+    {
+        err = "Unknown mode: " + mode + "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Cache key of a route query: everything its answer depends on. Answers
+// with search stats (--stats, pareto) are not cached: they time one run.
+inline string routeCacheKey(const RouteRequest &request)
+{
+    const RouteOptions &o = request.options;
+    return to_string(request.startId) + " " + to_string(request.targetId) + " " + request.mode + " " +
+           to_string((int)o.engine) + " " + to_string(o.maxBagSize) + " " + to_string(o.alternatives);
+}
+
+// Key of a pair in TieredRoutes: start index * stations + target index in
+// routes.bin, or -1 when a station is not in it
+inline long long storedPairKey(const RouteStore &store, long long startId, long long targetId)
+{
+    const vector<long long> &ids = store.stationIds();
+    auto s = lower_bound(ids.begin(), ids.end(), startId), t = lower_bound(ids.begin(), ids.end(), targetId);
+    if (s == ids.end() || *s != startId || t == ids.end() || *t != targetId) return -1;
+    return (long long)(s - ids.begin()) * ids.size() + (t - ids.begin());
+}
+
+inline json tierToJson(const TieredRoutes::TierStats &tier)
+{
+    return {{"entries", tier.entries}, {"capacity", tier.capacity}, {"lookups", tier.lookups}, {"p50_us", tier.p50Us},
+            {"p99_us", tier.p99Us}};
+}
+
+// What serve, http and librouting answer from, loaded once from the
+// working directory and shared by all their threads: the network with its landmarks, the precomputed files, the
+// CLOCK cache of repeated answers (see ResultCache) and the tiers of
+// precomputed answers from routes.bin (see TieredRoutes), which keep the
+// most requested ones decoded in memory.
+struct RouteService
+{
+    TramRouteFinder finder;
+    PrecomputedFiles files;
+    ResultCache cache;
+    TieredRoutes tiers;
+
+    RouteService(size_t cacheMb, size_t hotRoutes)
+        : finder(loadFinder(true, true)), cache(cacheMb << 20), tiers(hotRoutes)
+    {
+        if (finder.landmarkCount() == 0) finder.buildLandmarks(TramRouteFinder::DEFAULT_LANDMARKS);
+        openPrecomputed(files);
+    }
+
+    // Answers a route query given as the one-shot CLI's arguments: answer
+    // is what the CLI would print (stdout, then stderr); returns its exit
+    // status
+    int answer(QueryContext &context, const vector<string> &args, string &answer)
+    {
+        RouteRequest request;
+        if (!parseRouteRequest(args, request, answer)) return 1;
+        long long pairKey = request.mode == "precomputed" && files.hasStore && files.error.empty()
+                                ? storedPairKey(files.store, request.startId, request.targetId) : -1;
+        if (pairKey >= 0)
+        {
+            string tiered = tiers.lookup(pairKey, [&]() {
+                string out, err;
+                int code = answerRoute(context, files, request, out, err);
+                return char('0' + code) + out + err;
+            });
+            answer = tiered.substr(1);
+            return tiered[0] - '0';
+        }
+
+        string key = routeCacheKey(request), cached;
+        bool cacheable = !request.options.reportStats && !request.options.pareto;
+        if (cacheable && cache.get(key, cached))
+        {
+            answer = cached.substr(1);
+            return cached[0] - '0';
+        }
+        string out, err;
+        int status = answerRoute(context, files, request, out, err);
+        answer = out + err;
+        if (cacheable) cache.put(key, char('0' + status) + answer);
+        return status;
+    }
+
+    // The cache and tier counters as JSON
+    string stats() const
+    {
+        ResultCache::Stats stats = cache.stats();
+        return json{{"hits", stats.hits}, {"misses", stats.misses}, {"evictions", stats.evictions},
+                    {"entries", stats.entries}, {"bytes", stats.bytes},
+                    {"tiers", {{"hot", tierToJson(tiers.hotStats())}, {"store", tierToJson(tiers.storeStats())}}}}.dump() + "\n";
+    }
+};
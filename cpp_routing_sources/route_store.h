@@ -0,0 +1,292 @@
+#pragma once
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "binary_io.h"
+using namespace std;
+
+// One ride of a stored route: trip[board] .. trip[alight] of one trip,
+// walked backwards when alight < board. A ride that follows no trip's stop
+// order is kept as an explicit station list instead (see RouteStore).
+struct RouteSegment
+{
+    uint16_t trip;
+    uint16_t board;
+    uint16_t alight;
+};
+
+// A decoded segment: trip >= 0 with board/alight, or trip = -1 with the
+// line and its stations spelled out
+struct StoredLeg
+{
+    int trip;
+    int board;
+    int alight;
+    int line;
+    vector<int> stations;
+};
+
+// Precomputed routes as line segments, one block per source station.
+// "TRRS", uint32 version, station ids (int64 vector), uint32 trip count,
+// then uint64 block offsets (n + 1, from the start of the file). A block
+// holds uint32 route starts (n + 1) indexing its RouteSegment array, a
+// mirror bitset of n bits in uint64 words, the segments, and the uint32
+// fallback pool. Route s -> t is segments [start[t], start[t + 1]), empty
+// when there is none. When bit t is set the route is instead that of
+// t -> s walked backwards, and block t must store it. A fallback segment
+// has trip = FALLBACK and board:alight = the 32-bit pool offset of
+// (line, count, stations...). Blocks are read in place from an mmap, so a
+// lookup touches only its source's block, or the target's for a mirror.
+class RouteStore
+{
+public:
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint16_t FALLBACK = 0xFFFF;
+
+    RouteStore() = default;
+    RouteStore(const RouteStore &) = delete;
+    RouteStore &operator=(const RouteStore &) = delete;
+    ~RouteStore() { close(); }
+
+    // Maps the file; throws runtime_error if it is missing or malformed
+    void open(const string &filename)
+    {
+        close();
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("cannot open " + filename);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            throw runtime_error("cannot read " + filename);
+        }
+        void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) throw runtime_error("cannot map " + filename);
+        data = (const char *)mapped;
+        size = st.st_size;
+
+        try
+        {
+            BinaryReader in(data, size);
+            in.expectMagic("TRRS");
+            if (in.get<uint32_t>() != VERSION) throw runtime_error("unsupported route store version");
+            ids = in.getVector<long long>();
+            trips = in.get<uint32_t>();
+            blockOffset = in.getVector<uint64_t>();
+            bool ok = blockOffset.size() == ids.size() + 1 && blockOffset.back() == size;
+            for (size_t s = 0; ok && s < ids.size(); s++) ok = blockOffset[s] <= blockOffset[s + 1];
+            if (!ok || (!ids.empty() && blockOffset[0] != in.offset())) throw runtime_error("corrupt route store");
+        }
+        catch (...)
+        {
+            close();
+            throw;
+        }
+    }
+
+    void close()
+    {
+        if (data) munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+        ids.clear();
+        blockOffset.clear();
+    }
+
+    bool isOpen() const { return data != nullptr; }
+    const vector<long long> &stationIds() const { return ids; }
+    uint32_t tripCount() const { return trips; }
+
+    // Encoded block of source s, as encodeBlock built it
+    string block(int s) const { return string(data + blockOffset[s], blockOffset[s + 1] - blockOffset[s]); }
+
+    // Hash of the whole file, to tie RouteDependencies to it
+    uint64_t fingerprint() const { return fingerprintBytes(data, size); }
+
+    // Segments of route s -> t by station index; false when none is stored.
+    // Throws runtime_error if the block is malformed.
+    bool route(int s, int t, vector<StoredLeg> &legs) const
+    {
+        if (!mirrored(s, t)) return readBlock(data + blockOffset[s], blockOffset[s + 1] - blockOffset[s], ids.size(), t, legs);
+        if (mirrored(t, s)) throw runtime_error("corrupt route store");
+        if (!readBlock(data + blockOffset[t], blockOffset[t + 1] - blockOffset[t], ids.size(), s, legs)) return false;
+        reverse(legs.begin(), legs.end());
+        for (StoredLeg &leg : legs)
+        {
+            swap(leg.board, leg.alight);
+            reverse(leg.stations.begin(), leg.stations.end());
+        }
+        return true;
+    }
+
+    // True when route s -> t is stored as the reverse of t -> s
+    bool mirrored(int s, int t) const
+    {
+        size_t bitsAt = (ids.size() + 1) * sizeof(uint32_t);
+        if (blockOffset[s + 1] - blockOffset[s] < bitsAt + mirrorWords() * sizeof(uint64_t)) throw runtime_error("corrupt route store");
+        uint64_t word;
+        memcpy(&word, data + blockOffset[s] + bitsAt + t / 64 * sizeof(uint64_t), sizeof(word));
+        return word >> (t % 64) & 1;
+    }
+
+    // Segments an encoded block of n stations stores for target t, ignoring
+    // its mirror bit; false when there are none
+    static bool readBlock(const char *block, size_t blockSize, size_t n, int t, vector<StoredLeg> &legs)
+    {
+        legs.clear();
+        size_t segmentsAt = (n + 1) * sizeof(uint32_t) + (n + 63) / 64 * sizeof(uint64_t);
+        if (blockSize < segmentsAt) throw runtime_error("corrupt route store");
+        auto startAt = [&](size_t i)
+        {
+            uint32_t value;
+            memcpy(&value, block + i * sizeof(uint32_t), sizeof(value));
+            return value;
+        };
+        uint32_t first = startAt(t), last = startAt(t + 1);
+        if (first >= last) return false;
+
+        size_t totalSegments = startAt(n);
+        size_t poolAt = segmentsAt + totalSegments * sizeof(RouteSegment);
+        if (last > totalSegments || poolAt > blockSize) throw runtime_error("corrupt route store");
+
+        for (uint32_t i = first; i < last; i++)
+        {
+            RouteSegment segment;
+            memcpy(&segment, block + segmentsAt + i * sizeof(RouteSegment), sizeof(segment));
+            if (segment.trip != FALLBACK)
+            {
+                legs.push_back({segment.trip, segment.board, segment.alight, -1, {}});
+                continue;
+            }
+            uint32_t at = (uint32_t)segment.board << 16 | segment.alight;
+            if (at > (blockSize - poolAt) / sizeof(uint32_t)) throw runtime_error("corrupt route store");
+            BinaryReader entry(block + poolAt + at * sizeof(uint32_t), blockSize - poolAt - at * sizeof(uint32_t));
+            StoredLeg leg{-1, 0, 0, (int)entry.get<uint32_t>(), {}};
+            uint32_t count = entry.get<uint32_t>();
+            for (uint32_t k = 0; k < count; k++) leg.stations.push_back(entry.get<uint32_t>());
+            legs.push_back(move(leg));
+        }
+        return true;
+    }
+
+    // Builds one source block from its routes, indexed by target; targets
+    // marked in mirrored keep no segments of their own
+    static string encodeBlock(const vector<vector<StoredLeg>> &routes, const vector<char> &mirrored)
+    {
+        vector<uint32_t> start = {0};
+        vector<uint64_t> bits((routes.size() + 63) / 64, 0);
+        vector<RouteSegment> segments;
+        vector<uint32_t> pool;
+        for (size_t t = 0; t < routes.size(); t++)
+        {
+            if (mirrored[t])
+            {
+                bits[t / 64] |= 1ULL << (t % 64);
+                start.push_back(segments.size());
+                continue;
+            }
+            for (const StoredLeg &leg : routes[t])
+            {
+                if (leg.trip >= 0)
+                {
+                    segments.push_back({(uint16_t)leg.trip, (uint16_t)leg.board, (uint16_t)leg.alight});
+                    continue;
+                }
+                uint32_t at = pool.size();
+                segments.push_back({FALLBACK, (uint16_t)(at >> 16), (uint16_t)(at & 0xFFFF)});
+                pool.push_back(leg.line);
+                pool.push_back(leg.stations.size());
+                pool.insert(pool.end(), leg.stations.begin(), leg.stations.end());
+            }
+            start.push_back(segments.size());
+        }
+        string out((const char *)start.data(), start.size() * sizeof(uint32_t));
+        out.append((const char *)bits.data(), bits.size() * sizeof(uint64_t));
+        out.append((const char *)segments.data(), segments.size() * sizeof(RouteSegment));
+        out.append((const char *)pool.data(), pool.size() * sizeof(uint32_t));
+        return out;
+    }
+
+    // Header and block offsets in front of the encoded blocks
+    static string assemble(const vector<long long> &stationIds, uint32_t tripCount, const vector<string> &blocks)
+    {
+        BinaryWriter out;
+        out.bytes = "TRRS";
+        out.put<uint32_t>(VERSION);
+        out.putVector(stationIds);
+        out.put<uint32_t>(tripCount);
+        size_t headerSize = out.bytes.size() + sizeof(uint64_t) * (blocks.size() + 2);
+        vector<uint64_t> offsets = {headerSize};
+        for (const string &block : blocks) offsets.push_back(offsets.back() + block.size());
+        out.putVector(offsets);
+        for (const string &block : blocks) out.bytes += block;
+        return out.bytes;
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    vector<long long> ids;
+    uint32_t trips = 0;
+    vector<uint64_t> blockOffset;
+
+    size_t mirrorWords() const { return (ids.size() + 63) / 64; }
+};
+
+// What each source block of a route store was built from, so the store can
+// be updated when the network changes: the compiled network it was built on
+// (TramRouteFinder::compile) and, per source, bitsets of the lines, trips
+// and station pairs its routes use, mirrored routes included. Station
+// pairs are the adjacent (u, v), u < v, of that network in sorted order.
+struct RouteDependencies
+{
+    static constexpr uint32_t VERSION = 1;
+
+    uint64_t storeFingerprint = 0; // RouteStore::fingerprint of the store
+    string network;
+    uint32_t lineWords = 0, tripWords = 0, pairWords = 0;
+    vector<uint64_t> bits; // rowWords() per source: lines, trips, pairs
+
+    size_t rowWords() const { return lineWords + tripWords + pairWords; }
+    size_t sourceCount() const { return rowWords() ? bits.size() / rowWords() : 0; }
+    uint64_t *row(int s) { return bits.data() + s * rowWords(); }
+    const uint64_t *row(int s) const { return bits.data() + s * rowWords(); }
+
+    // "TRDP", uint32 version, then the fields above
+    string serialize() const
+    {
+        BinaryWriter out;
+        out.bytes = "TRDP";
+        out.put<uint32_t>(VERSION);
+        out.put<uint64_t>(storeFingerprint);
+        out.putString(network);
+        out.put<uint32_t>(lineWords);
+        out.put<uint32_t>(tripWords);
+        out.put<uint32_t>(pairWords);
+        out.putVector(bits);
+        return out.bytes;
+    }
+
+    // Inverse of serialize(); throws runtime_error on malformed input
+    static RouteDependencies parse(const string &bytes)
+    {
+        BinaryReader in(bytes);
+        in.expectMagic("TRDP");
+        if (in.get<uint32_t>() != VERSION) throw runtime_error("unsupported route dependency version");
+        RouteDependencies deps;
+        deps.storeFingerprint = in.get<uint64_t>();
+        deps.network = in.getString();
+        deps.lineWords = in.get<uint32_t>();
+        deps.tripWords = in.get<uint32_t>();
+        deps.pairWords = in.get<uint32_t>();
+        deps.bits = in.getVector<uint64_t>();
+        if (!in.atEnd() || (deps.rowWords() ? deps.bits.size() % deps.rowWords() : deps.bits.size()) != 0)
+        {
+            throw runtime_error("corrupt route dependencies");
+        }
+        return deps;
+    }
+};
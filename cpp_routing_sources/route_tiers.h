@@ -0,0 +1,224 @@
+#pragma once
+#include <bits/stdc++.h>
+using namespace std;
+
+// Approximate access counts of 64-bit keys in depth rows of saturating
+// 16-bit counters. A key's estimate is the minimum of its counters, which
+// never undercounts; only the counters at that minimum are raised
+// (conservative update). Every sampleSize additions all counters are
+// halved, so old popularity fades and estimates follow current traffic.
+class CountMinSketch
+{
+public:
+    static constexpr int DEPTH = 4;
+
+    CountMinSketch(size_t width, uint64_t sampleSize)
+        : sampleSize(max<uint64_t>(sampleSize, 1))
+    {
+        size_t rowWidth = 64;
+        while (rowWidth < width) rowWidth *= 2;
+        mask = rowWidth - 1;
+        counters.assign(DEPTH * rowWidth, 0);
+    }
+
+    // Counts one access of key; returns its new estimate
+    uint32_t add(uint64_t key)
+    {
+        size_t at[DEPTH];
+        uint16_t low = UINT16_MAX;
+        for (int row = 0; row < DEPTH; row++)
+        {
+            at[row] = slot(key, row);
+            low = min(low, counters[at[row]]);
+        }
+        if (low < UINT16_MAX)
+        {
+            for (size_t i : at)
+                if (counters[i] == low) counters[i]++;
+            low++;
+        }
+        if (++additions >= sampleSize) age();
+        return low;
+    }
+
+    uint32_t estimate(uint64_t key) const
+    {
+        uint16_t low = UINT16_MAX;
+        for (int row = 0; row < DEPTH; row++) low = min(low, counters[slot(key, row)]);
+        return low;
+    }
+
+    size_t bytes() const { return counters.size() * sizeof(uint16_t); }
+
+private:
+    size_t mask;
+    uint64_t sampleSize;
+    uint64_t additions = 0;
+    vector<uint16_t> counters;
+
+    size_t slot(uint64_t key, int row) const
+    {
+        uint64_t h = (key + row) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        return row * (mask + 1) + ((h >> 32) & mask);
+    }
+
+    void age()
+    {
+        for (uint16_t &c : counters) c >>= 1;
+        additions = 0;
+    }
+};
+
+// Latency distribution in nanoseconds: 8 buckets per power of two, so a
+// percentile is within about 9% of the true value
+struct LatencyHistogram
+{
+    static constexpr int SUB = 8;
+    array<uint64_t, 64 * SUB> counts{};
+    uint64_t total = 0;
+
+    void add(uint64_t ns)
+    {
+        counts[bucket(ns)]++;
+        total++;
+    }
+
+    // Upper bound of the bucket holding quantile q, in microseconds
+    double percentileUs(double q) const
+    {
+        if (total == 0) return 0;
+        uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(q * total)), seen = 0;
+        for (size_t b = 0; b < counts.size(); b++)
+        {
+            seen += counts[b];
+            if (seen >= rank) return upperBound(b) / 1e3;
+        }
+        return 0;
+    }
+
+private:
+    static size_t bucket(uint64_t ns)
+    {
+        if (ns < SUB) return ns;
+        int power = 63 - __builtin_clzll(ns);
+        return (power - 2) * SUB + (ns >> (power - 3) & (SUB - 1));
+    }
+
+    static double upperBound(size_t b)
+    {
+        if (b < SUB) return b + 1;
+        int power = b / SUB + 2;
+        return (double)(SUB + b % SUB + 1) * (1ULL << (power - 3));
+    }
+};
+
+// Responses of precomputed routes in two tiers: a hot tier of decoded
+// responses held in memory for the most requested pairs, and the mapped
+// route store behind it, decoded per lookup. Every lookup is counted in a
+// CountMinSketch. A pair decoded from the store joins the hot tier while
+// there is room; once it is full, it replaces the least requested of a
+// few sampled residents if it is requested more often, so residency
+// follows the traffic as it shifts. Lookups are timed per tier.
+class TieredRoutes
+{
+public:
+    static constexpr int EVICTION_SAMPLE = 8;
+
+    struct TierStats
+    {
+        size_t entries = 0;
+        size_t capacity = 0;
+        uint64_t lookups = 0;
+        double p50Us = 0;
+        double p99Us = 0;
+    };
+
+    // hotCapacity responses in memory; the sketch is sized to it
+    explicit TieredRoutes(size_t hotCapacity)
+        : capacity(hotCapacity), sketch(hotCapacity * 8, max<size_t>(hotCapacity * 10, 1024))
+    {
+    }
+
+    TieredRoutes(const TieredRoutes &) = delete;
+    TieredRoutes &operator=(const TieredRoutes &) = delete;
+
+    // The response for key: the hot tier's copy when resident, else what
+    // decode returns from the store, called without the lock held
+    template <class Decode>
+    string lookup(uint64_t key, Decode &&decode)
+    {
+        auto started = chrono::steady_clock::now();
+        unique_lock<mutex> lock(guard);
+        uint32_t frequency = sketch.add(key);
+        auto it = hot.find(key);
+        if (it != hot.end())
+        {
+            string response = it->second.response;
+            hotLatency.add(nanosSince(started));
+            return response;
+        }
+        lock.unlock();
+
+        string response = decode();
+        lock.lock();
+        if (!hot.count(key)) admit(key, frequency, response);
+        storeLatency.add(nanosSince(started));
+        return response;
+    }
+
+    TierStats hotStats() const
+    {
+        lock_guard<mutex> lock(guard);
+        return {hot.size(), capacity, hotLatency.total, hotLatency.percentileUs(0.5), hotLatency.percentileUs(0.99)};
+    }
+
+    TierStats storeStats() const
+    {
+        lock_guard<mutex> lock(guard);
+        return {0, 0, storeLatency.total, storeLatency.percentileUs(0.5), storeLatency.percentileUs(0.99)};
+    }
+
+private:
+    struct Resident
+    {
+        size_t slot; // index in keys
+        string response;
+    };
+
+    size_t capacity;
+    CountMinSketch sketch;
+    unordered_map<uint64_t, Resident> hot;
+    vector<uint64_t> keys; // resident keys, for sampling
+    mt19937_64 rng{0x5EED};
+    LatencyHistogram hotLatency, storeLatency;
+    mutable mutex guard;
+
+    static uint64_t nanosSince(chrono::steady_clock::time_point started)
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    }
+
+    void admit(uint64_t key, uint32_t frequency, const string &response)
+    {
+        if (capacity == 0) return;
+        if (hot.size() >= capacity)
+        {
+            uint64_t victim = keys[rng() % keys.size()];
+            for (int i = 1; i < EVICTION_SAMPLE; i++)
+            {
+                uint64_t other = keys[rng() % keys.size()];
+                if (sketch.estimate(other) < sketch.estimate(victim)) victim = other;
+            }
+            if (sketch.estimate(victim) >= frequency) return;
+            size_t slot = hot[victim].slot;
+            keys[slot] = keys.back();
+            hot[keys[slot]].slot = slot;
+            keys.pop_back();
+            hot.erase(victim);
+        }
+        hot.emplace(key, Resident{keys.size(), response});
+        keys.push_back(key);
+    }
+};
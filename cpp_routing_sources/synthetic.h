@@ -0,0 +1,170 @@
+#pragma once
+#include <bits/stdc++.h>
+using namespace std;
+
+// Generated tram networks for benchmarks, in the shape TramRouteFinder takes
+struct SyntheticNetwork
+{
+    vector<vector<long long>> trips;
+    vector<string> tripNames;
+    map<string, int> linePrices;
+    map<long long, string> stationNames;
+    string stopTimes; // gtfs/stop_times.txt content
+    map<long long, pair<double, double>> coordinates; // longitude, latitude
+
+    size_t stationCount() const { return stationNames.size(); }
+
+    // gtfs/stops.txt content for the generated stations
+    string stopsTxt() const
+    {
+        string out = "ID,English Name,Arabic Name,Longitude,Latitude\n";
+        char position[64];
+        for (const auto &[id, lonLat] : coordinates)
+        {
+            snprintf(position, sizeof(position), "%.7f,%.7f", lonLat.first, lonLat.second);
+            out += to_string(id) + "," + stationNames.at(id) + ",," + position + "\n";
+        }
+        return out;
+    }
+};
+
+// One unit of the generator's plane is about 400 m, centred on Alexandria
+inline pair<double, double> syntheticLonLat(double x, double y)
+{
+    return {29.90 + x * 0.004, 31.20 + y * 0.004};
+}
+
+// Appends one trip and its stop_times rows, with 1-4 minutes between stops.
+// positions, if given, holds the plane (x, y) of every stop.
+inline void addSyntheticTrip(SyntheticNetwork &net, const string &name, int fare,
+                             const vector<long long> &stops, mt19937 &rng,
+                             const vector<pair<double, double>> &positions = {})
+{
+    if (net.stopTimes.empty()) net.stopTimes = "trip_id,arrival_time,departure_time,stop_id,stop_sequence\n";
+
+    net.trips.push_back(stops);
+    net.tripNames.push_back(name);
+    net.linePrices[name] = fare;
+
+    int minutes = 0;
+    char clock[32];
+    for (size_t i = 0; i < stops.size(); i++)
+    {
+        if (i > 0) minutes += 1 + rng() % 4;
+        snprintf(clock, sizeof(clock), "%02d:%02d:00", minutes / 60, minutes % 60);
+        net.stopTimes += name + "," + clock + "," + clock + "," + to_string(stops[i]) + "," + to_string(i + 1) + "\n";
+        if (!net.stationNames.count(stops[i])) net.stationNames[stops[i]] = "Station " + to_string(stops[i]);
+        if (i < positions.size()) net.coordinates[stops[i]] = syntheticLonLat(positions[i].first, positions[i].second);
+    }
+}
+
+// side horizontal and side vertical lines crossing at shared interchange
+// stations, with spacing plain stations between neighbouring crossings.
+// Horizontal lines cost 5 and vertical lines 10.
+inline SyntheticNetwork gridNetwork(int side, int spacing, unsigned seed = 1)
+{
+    SyntheticNetwork net;
+    mt19937 rng(seed);
+    long long nextId = 1;
+    vector<vector<long long>> crossing(side, vector<long long>(side));
+    for (auto &row : crossing)
+    {
+        for (auto &id : row) id = nextId++;
+    }
+
+    for (int dir = 0; dir < 2; dir++)
+    {
+        for (int i = 0; i < side; i++)
+        {
+            vector<long long> stops;
+            for (int j = 0; j < side; j++)
+            {
+                if (j > 0)
+                {
+                    for (int k = 0; k < spacing; k++) stops.push_back(nextId++);
+                }
+                stops.push_back(dir == 0 ? crossing[i][j] : crossing[j][i]);
+            }
+
+            // Stop p of line i lies p units along it; crossings line up across directions
+            vector<pair<double, double>> positions;
+            for (size_t p = 0; p < stops.size(); p++)
+            {
+                double across = i * (spacing + 1);
+                positions.push_back(dir == 0 ? make_pair((double)p, across) : make_pair(across, (double)p));
+            }
+            addSyntheticTrip(net, (dir == 0 ? "H" : "V") + to_string(i), dir == 0 ? 5 : 10, stops, rng, positions);
+        }
+    }
+    return net;
+}
+
+// Grid network with roughly the requested number of stations
+inline SyntheticNetwork gridNetworkOfSize(int stations, int side = 10, unsigned seed = 1)
+{
+    int spacing = max(0, (stations - side * side) / (2 * side * (side - 1)));
+    return gridNetwork(side, spacing, seed);
+}
+
+// spokes lines running out of one central hub, each length stations long,
+// crossed by rings circular lines; ring r links the r-th stations of
+// consecutive spokes via spacing plain stations and closes on itself.
+// Spokes cost 5 and rings 10.
+inline SyntheticNetwork radialNetwork(int spokes, int length, int rings, int spacing, unsigned seed = 1)
+{
+    SyntheticNetwork net;
+    mt19937 rng(seed);
+    long long nextId = 1;
+    long long hub = nextId++;
+
+    // Spoke i points at angle 2 pi i / spokes; its j-th stop is j units out
+    auto polar = [&](double radius, double spoke)
+    {
+        double angle = 2 * M_PI * spoke / spokes;
+        return make_pair(radius * cos(angle), radius * sin(angle));
+    };
+
+    vector<vector<long long>> spokeStops(spokes);
+    for (int i = 0; i < spokes; i++)
+    {
+        vector<pair<double, double>> positions;
+        spokeStops[i].push_back(hub);
+        positions.push_back(polar(0, i));
+        for (int j = 1; j <= length; j++)
+        {
+            spokeStops[i].push_back(nextId++);
+            positions.push_back(polar(j, i));
+        }
+        addSyntheticTrip(net, "S" + to_string(i), 5, spokeStops[i], rng, positions);
+    }
+
+    for (int r = 1; r <= rings; r++)
+    {
+        int radius = max(r * length / (rings + 1), 1);
+        vector<long long> stops;
+        vector<pair<double, double>> positions;
+        for (int i = 0; i <= spokes; i++)
+        {
+            if (i > 0 && i < spokes)
+            {
+                for (int k = 1; k <= spacing; k++)
+                {
+                    stops.push_back(nextId++);
+                    positions.push_back(polar(radius, i - 1 + (double)k / (spacing + 1)));
+                }
+            }
+            stops.push_back(spokeStops[i % spokes][radius]);
+            positions.push_back(polar(radius, i));
+        }
+        addSyntheticTrip(net, "R" + to_string(r), 10, stops, rng, positions);
+    }
+    return net;
+}
+
+// Radial network with roughly the requested number of stations
+inline SyntheticNetwork radialNetworkOfSize(int stations, int spokes = 12, int rings = 4, unsigned seed = 1)
+{
+    int length = max(2, stations / (2 * spokes));
+    int spacing = max(0, (stations - spokes * length) / (rings * (spokes - 1)));
+    return radialNetwork(spokes, length, rings, spacing, seed);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "binary_io.h"
+using namespace std;
+
+// One line change of an optimal route: the rider leaves station `from` and
+// arrives at station `to` already on `line`. A source's first node has
+// from = -1 and to = the source station. Station and line numbers are
+// TramRouteFinder indices.
+struct PatternNode
+{
+    int32_t parent; // previous change of the same route, -1 at the start
+    int32_t from;
+    int32_t to;
+    int32_t line;
+};
+
+// Transfer patterns of every source station. The nodes of one source form
+// a DAG in which every route shares the prefix of line changes it has in
+// common with others: nodes[nodeOffset[s] .. nodeOffset[s + 1] - 1], with
+// parent indices relative to that block. targetNode[s * n + t] is the last
+// change of the route s -> t, or -1 when t is unreachable or t = s.
+struct TransferPatterns
+{
+    static constexpr uint32_t VERSION = 1;
+
+    vector<long long> stationIds; // index order of the network they were built on
+    vector<string> lineNames;
+    vector<uint32_t> nodeOffset;
+    vector<PatternNode> nodes;
+    vector<int32_t> targetNode;
+
+    // "TRTP", uint32 version, station ids, line names, then the arrays above
+    string serialize() const
+    {
+        BinaryWriter out;
+        out.bytes = "TRTP";
+        out.put<uint32_t>(VERSION);
+        out.putVector(stationIds);
+        out.put<uint32_t>(lineNames.size());
+        for (const string &line : lineNames) out.putString(line);
+        out.putVector(nodeOffset);
+        out.putVector(nodes);
+        out.putVector(targetNode);
+        return out.bytes;
+    }
+
+    // Inverse of serialize(); throws runtime_error on malformed input
+    static TransferPatterns parse(string_view bytes)
+    {
+        BinaryReader in(bytes.data(), bytes.size());
+        in.expectMagic("TRTP");
+        if (in.get<uint32_t>() != VERSION) throw runtime_error("unsupported transfer pattern version");
+
+        TransferPatterns p;
+        p.stationIds = in.getVector<long long>();
+        for (uint32_t i = 0, count = in.get<uint32_t>(); i < count; i++) p.lineNames.push_back(in.getString());
+        p.nodeOffset = in.getVector<uint32_t>();
+        p.nodes = in.getVector<PatternNode>();
+        p.targetNode = in.getVector<int32_t>();
+
+        size_t n = p.stationIds.size();
+        bool ok = p.nodeOffset.size() == n + 1 && p.nodeOffset[0] == 0 && p.nodeOffset[n] == p.nodes.size() &&
+                  p.targetNode.size() == n * n && in.atEnd();
+        for (size_t s = 0; ok && s < n; s++)
+        {
+            int blockSize = p.nodeOffset[s + 1] - p.nodeOffset[s];
+            ok = p.nodeOffset[s] <= p.nodeOffset[s + 1];
+            for (int i = 0; ok && i < blockSize; i++)
+            {
+                const PatternNode &node = p.nodes[p.nodeOffset[s] + i];
+                ok = node.parent >= -1 && node.parent < i && node.from >= -1 && node.from < (int)n && node.to >= 0 &&
+                     node.to < (int)n && node.line >= 0 && node.line < (int)p.lineNames.size();
+            }
+            for (size_t t = 0; ok && t < n; t++) ok = p.targetNode[s * n + t] >= -1 && p.targetNode[s * n + t] < blockSize;
+        }
+        if (!ok) throw runtime_error("corrupt transfer patterns");
+        return p;
+    }
+};
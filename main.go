@@ -9,6 +9,7 @@ import (
 	"net/http"
 	"os"
 	"os/signal"
+	"strconv"
 	"syscall"
 	"time"
 )
@@ -19,6 +20,9 @@ func main() {
 
 	mux := http.NewServeMux()
 	mux.HandleFunc("GET /getPath", getPathHandler)
+	mux.HandleFunc("POST /getPaths", getPathsHandler)
+	mux.HandleFunc("GET /getReachable", getReachableHandler)
+	mux.HandleFunc("GET /routeCacheStats", routeCacheStatsHandler)
 
 	server := &http.Server{
 		Addr:    ":" + fmt.Sprint(PORT),
@@ -65,28 +69,135 @@ func getPathHandler(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 
+	var options []string
+	if k := q.Get("k"); k != "" {
+		if n, err := strconv.Atoi(k); err != nil || n < 1 {
+			http.Error(w, "k must be a positive integer", http.StatusBadRequest)
+			return
+		}
+		options = append(options, "--k="+k)
+	}
+
 	// call your CLI wrapper, which returns JSON
-	data, err := routing.GetRoute(start, end, mode)
+	data, err := routing.GetRoute(start, end, mode, options...)
 	if err != nil {
 		log.Printf("routing error: %v", err)
 		http.Error(w, err.Error(), http.StatusInternalServerError)
 		return
 	}
 
-	// ensure valid JSON
+	// ensure valid JSON; it is passed on as it is, never decoded
 	if !json.Valid(data) {
 		log.Printf("invalid JSON from CLI: %q", data)
 		http.Error(w, "bad JSON from routing engine", http.StatusInternalServerError)
 		return
 	}
-	// Unmarshal JSON into a map
-	var result map[string]interface{}
-	if err := json.Unmarshal(data, &result); err != nil {
-		log.Printf("failed to unmarshal JSON: %v", err)
-		http.Error(w, "failed to parse routing engine response", http.StatusInternalServerError)
+
+	w.Header().Set("Content-Type", "application/json")
+	w.Write(data)
+}
+
+// routeCacheStatsHandler reports the hit, miss and eviction counters of the
+// routing daemon's result cache.
+func routeCacheStatsHandler(w http.ResponseWriter, r *http.Request) {
+	data, err := routing.GetRouteCacheStats()
+	if err != nil {
+		log.Printf("routing error: %v", err)
+		http.Error(w, err.Error(), http.StatusInternalServerError)
 		return
 	}
 
 	w.Header().Set("Content-Type", "application/json")
 	w.Write(data)
 }
+
+// getReachableHandler lists the stations reachable from start within time
+// minutes and a fare of at most cost, with coordinates for drawing isochrones.
+func getReachableHandler(w http.ResponseWriter, r *http.Request) {
+	q := r.URL.Query()
+	start := q.Get("start")
+	maxTime := q.Get("time")
+	maxCost := q.Get("cost")
+
+	if start == "" || maxTime == "" || maxCost == "" {
+		http.Error(w, "missing start, time or cost param", http.StatusBadRequest)
+		return
+	}
+
+	data, err := routing.GetReachable(start, maxTime, maxCost)
+	if err != nil {
+		log.Printf("routing error: %v", err)
+		http.Error(w, err.Error(), http.StatusInternalServerError)
+		return
+	}
+
+	if !json.Valid(data) {
+		log.Printf("invalid JSON from CLI: %q", data)
+		http.Error(w, "bad JSON from routing engine", http.StatusInternalServerError)
+		return
+	}
+
+	w.Header().Set("Content-Type", "application/json")
+	w.Write(data)
+}
+
+// maxBatchBody bounds the request body of /getPaths
+const maxBatchBody = 16 << 20
+
+type pathQuery struct {
+	Start string `json:"start"`
+	End   string `json:"end"`
+}
+
+// getPathsHandler answers many (start, end) pairs in a single routing run.
+// The body is a JSON array of {"start": ..., "end": ...} objects and the
+// format query param selects "ndjson" (default) or a binary "matrix".
+func getPathsHandler(w http.ResponseWriter, r *http.Request) {
+	format := r.URL.Query().Get("format")
+	if format == "" {
+		format = "ndjson"
+	}
+	if format != "ndjson" && format != "matrix" {
+		http.Error(w, "format must be ndjson or matrix", http.StatusBadRequest)
+		return
+	}
+
+	var queries []pathQuery
+	if err := json.NewDecoder(http.MaxBytesReader(w, r.Body, maxBatchBody)).Decode(&queries); err != nil {
+		http.Error(w, "body must be a JSON array of {start, end} objects", http.StatusBadRequest)
+		return
+	}
+	if len(queries) == 0 {
+		http.Error(w, "no pairs given", http.StatusBadRequest)
+		return
+	}
+
+	pairs := make([][2]string, len(queries))
+	for i, q := range queries {
+		if q.Start == "" || q.End == "" {
+			http.Error(w, fmt.Sprintf("pair %d is missing start or end", i), http.StatusBadRequest)
+			return
+		}
+		_, startErr := strconv.ParseInt(q.Start, 10, 64)
+		_, endErr := strconv.ParseInt(q.End, 10, 64)
+		if startErr != nil || endErr != nil {
+			http.Error(w, fmt.Sprintf("pair %d: start and end must be integer station ids", i), http.StatusBadRequest)
+			return
+		}
+		pairs[i] = [2]string{q.Start, q.End}
+	}
+
+	data, err := routing.GetRoutes(pairs, format)
+	if err != nil {
+		log.Printf("routing error: %v", err)
+		http.Error(w, err.Error(), http.StatusInternalServerError)
+		return
+	}
+
+	if format == "matrix" {
+		w.Header().Set("Content-Type", "application/octet-stream")
+	} else {
+		w.Header().Set("Content-Type", "application/x-ndjson")
+	}
+	w.Write(data)
+}
@@ -0,0 +1,117 @@
+//go:build routing_cgo
+
+package routing
+
+/*
+#cgo CFLAGS: -I${SRCDIR}/../cpp_routing_sources
+#cgo LDFLAGS: -L${SRCDIR}/../cpp_binaries -lrouting -lstdc++ -lm -lpthread
+#include <stdlib.h>
+#include "librouting.h"
+*/
+import "C"
+
+import (
+	"bytes"
+	"fmt"
+	"sync"
+	"unsafe"
+)
+
+// The route finder linked into this process from
+// cpp_binaries/librouting.a: the network and precomputed files are loaded
+// from the working directory once, when the server starts, and queries
+// call into it directly. The library copies each answer into a pooled Go
+// buffer, and the caller gets it copied out at its exact size.
+var (
+	openOnce sync.Once
+	network  *C.routing_network
+	openErr  error
+
+	// answer buffers reused across queries: they start at 16 KiB, about
+	// the largest common route answer, and keep whatever size they grew to
+	answerBuffers = sync.Pool{New: func() any {
+		buffer := make([]byte, 16<<10)
+		return &buffer
+	}}
+)
+
+// a failure is reported by every query
+func init() { open() }
+
+func open() error {
+	openOnce.Do(func() {
+		var reason [512]C.char
+		network = C.routing_open(64, 4096, &reason[0], C.size_t(len(reason)))
+		if network == nil {
+			openErr = fmt.Errorf("routing library failed to load: %s", C.GoString(&reason[0]))
+		}
+	})
+	return openErr
+}
+
+// GetRoute answers (start, end, mode) plus any extra CLI options (e.g.
+// "--k=3") in process and returns the JSON the CLI would print, or an
+// error carrying the CLI's output when it would exit non-zero.
+func GetRoute(start, end, mode string, options ...string) ([]byte, error) {
+	args, err := routeArgs(start, end, mode, options)
+	if err != nil {
+		return nil, err
+	}
+	if err := open(); err != nil {
+		return nil, err
+	}
+
+	// the library may not keep Go pointers, so the arguments go in C memory
+	cArgs := make([]*C.char, len(args))
+	for i, arg := range args {
+		cArgs[i] = C.CString(arg)
+		defer C.free(unsafe.Pointer(cArgs[i]))
+	}
+	argv := (**C.char)(C.malloc(C.size_t(len(args)) * C.size_t(unsafe.Sizeof(cArgs[0]))))
+	defer C.free(unsafe.Pointer(argv))
+	copy(unsafe.Slice(argv, len(args)), cArgs)
+
+	status, out, err := answer(func(buffer *C.char, capacity C.size_t, length *C.size_t) C.int {
+		return C.routing_query(network, argv, C.int(len(args)), buffer, capacity, length)
+	})
+	if err != nil {
+		return nil, err
+	}
+	if status != 0 {
+		return nil, fmt.Errorf("routing binary failed: exit status %d\noutput:\n%s", status, out)
+	}
+	return out, nil
+}
+
+// GetRouteCacheStats returns the result cache counters as JSON: hits,
+// misses, evictions, entries and bytes.
+func GetRouteCacheStats() ([]byte, error) {
+	if err := open(); err != nil {
+		return nil, err
+	}
+	_, out, err := answer(func(buffer *C.char, capacity C.size_t, length *C.size_t) C.int {
+		return C.routing_stats(network, buffer, capacity, length)
+	})
+	return out, err
+}
+
+// answer runs call on a pooled buffer, and again on a larger one when the
+// answer does not fit
+func answer(call func(buffer *C.char, capacity C.size_t, length *C.size_t) C.int) (int, []byte, error) {
+	buffer := answerBuffers.Get().(*[]byte)
+	defer answerBuffers.Put(buffer)
+	for {
+		var length C.size_t
+		status := call((*C.char)(unsafe.Pointer(&(*buffer)[0])), C.size_t(len(*buffer)), &length)
+		if status == C.ROUTING_BUFFER_TOO_SMALL {
+			*buffer = make([]byte, length)
+			continue
+		}
+		// the buffer goes back to the pool, so the answer leaves as a copy
+		out := bytes.Clone((*buffer)[:length])
+		if status == C.ROUTING_FAILED {
+			return 0, nil, fmt.Errorf("routing library failed: %s", out)
+		}
+		return int(status), out, nil
+	}
+}
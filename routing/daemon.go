@@ -0,0 +1,185 @@
+//go:build !routing_cgo
+
+package routing
+
+import (
+	"bufio"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"strings"
+	"sync"
+)
+
+// GetRoute asks the routing daemon for (start, end, mode) plus any extra
+// CLI options (e.g. "--k=3") and returns the JSON the CLI would print, or
+// an error carrying the CLI's output when it would exit non-zero.
+func GetRoute(start, end, mode string, options ...string) ([]byte, error) {
+	args, err := routeArgs(start, end, mode, options)
+	if err != nil {
+		return nil, err
+	}
+	status, out, err := server.call(strings.Join(args, " "))
+	if err != nil {
+		return nil, err
+	}
+	if status != 0 {
+		return nil, fmt.Errorf("routing binary failed: exit status %d\noutput:\n%s", status, out)
+	}
+	return out, nil
+}
+
+// GetRouteCacheStats returns the daemon's result cache counters as JSON:
+// hits, misses, evictions, entries and bytes.
+func GetRouteCacheStats() ([]byte, error) {
+	_, out, err := server.call("stats")
+	return out, err
+}
+
+// daemon is one long-lived `routing serve` process shared by all route
+// queries: the network and precomputed files are loaded once and repeated
+// queries are answered from its cache by its pool of query workers.
+// Requests carry an id, so queries from many goroutines are in flight at
+// once and answered in any order; the process is started on first use and
+// again after it exits. Calling goroutines never write to the pipe
+// themselves: they queue their request line on a channel and park, and
+// one writer goroutine sends whatever is queued in a single write.
+type daemon struct {
+	mu       sync.Mutex // guards the fields below
+	stdin    io.WriteCloser
+	requests chan string
+	quit     chan struct{} // closed when the process is dropped
+	nextID   uint64
+	pending  map[uint64]chan reply
+}
+
+type reply struct {
+	status int
+	out    []byte
+	err    error
+}
+
+var server daemon
+
+// call queues one request line and waits for its answer
+func (d *daemon) call(request string) (int, []byte, error) {
+	done := make(chan reply, 1)
+	d.mu.Lock()
+	if d.stdin == nil {
+		if err := d.start(); err != nil {
+			d.mu.Unlock()
+			return 0, nil, err
+		}
+	}
+	d.nextID++
+	id := d.nextID
+	d.pending[id] = done
+	requests, quit := d.requests, d.quit
+	d.mu.Unlock()
+
+	select {
+	case requests <- fmt.Sprintf("%d %s\n", id, request):
+	case <-quit: // fail answers done
+	}
+	r := <-done
+	return r.status, r.out, r.err
+}
+
+// start launches the daemon; d.mu is held
+func (d *daemon) start() error {
+	cmd := exec.Command("./cpp_binaries/routing", "serve")
+	cmd.Stderr = os.Stderr
+	stdin, err := cmd.StdinPipe()
+	if err != nil {
+		return err
+	}
+	stdout, err := cmd.StdoutPipe()
+	if err != nil {
+		return err
+	}
+	if err := cmd.Start(); err != nil {
+		return fmt.Errorf("routing daemon failed to start: %w", err)
+	}
+	d.stdin = stdin
+	d.requests = make(chan string, 1024)
+	d.quit = make(chan struct{})
+	d.pending = make(map[uint64]chan reply)
+	go d.write(stdin, d.requests, d.quit)
+	go d.read(cmd, stdin, bufio.NewReader(stdout))
+	return nil
+}
+
+// write sends the queued request lines, everything queued at the time in
+// one write, until quit is closed. After a failed write the process is
+// gone; read then sees its output end and fails the pending calls.
+func (d *daemon) write(stdin io.WriteCloser, requests <-chan string, quit <-chan struct{}) {
+	out := bufio.NewWriter(stdin)
+	for {
+		select {
+		case line := <-requests:
+			out.WriteString(line)
+			for queued := true; queued; {
+				select {
+				case line := <-requests:
+					out.WriteString(line)
+				default:
+					queued = false
+				}
+			}
+			if err := out.Flush(); err != nil {
+				stdin.Close()
+				<-quit
+				return
+			}
+		case <-quit:
+			return
+		}
+	}
+}
+
+// read hands each framed answer "<id> <status> <length>\n<bytes>" to the
+// call waiting for it until the daemon's output ends
+func (d *daemon) read(cmd *exec.Cmd, stdin io.WriteCloser, out *bufio.Reader) {
+	var err error
+	for err == nil {
+		var id uint64
+		var status, length int
+		if _, err = fmt.Fscanf(out, "%d %d %d\n", &id, &status, &length); err != nil {
+			break
+		}
+		body := make([]byte, length)
+		if _, err = io.ReadFull(out, body); err != nil {
+			break
+		}
+		d.mu.Lock()
+		done := d.pending[id]
+		delete(d.pending, id)
+		d.mu.Unlock()
+		if done != nil {
+			done <- reply{status: status, out: body}
+		}
+	}
+	stdin.Close()
+	waitErr := cmd.Wait()
+	d.mu.Lock()
+	if d.stdin == stdin {
+		d.fail(errors.Join(errors.New("routing daemon exited"), waitErr))
+	}
+	d.mu.Unlock()
+}
+
+// fail ends every pending call with err and drops the process, so the next
+// call starts a new one; d.mu is held
+func (d *daemon) fail(err error) {
+	if d.stdin != nil {
+		d.stdin.Close()
+		close(d.quit)
+	}
+	d.stdin = nil
+	for id, done := range d.pending {
+		done <- reply{err: err}
+		delete(d.pending, id)
+	}
+}
@@ -1,19 +1,71 @@
 package routing
 
 import (
+	"bytes"
 	"fmt"
-	"os/exec"
+	"strconv"
+	"strings"
 )
 
-// GetRoute runs the routing CLI with (start, end, mode)
-// and returns its JSON stdout or an error.
-func GetRoute(start, end, mode string) ([]byte, error) {
-	// adjust "./routing/routing" to the correct path of your CLI binary
-	cmd := exec.Command("./cpp_binaries/routing", start, end, mode)
-	out, err := cmd.CombinedOutput()
+// Route queries go to a `routing serve` daemon (daemon.go) or, built with
+// -tags routing_cgo, straight to the route finder linked into the process
+// (cgo.go). Batch and isochrone queries run the CLI in a child of the
+// routing zygote (zygote.go), which starts with the network loaded.
+
+// routeArgs are the routing CLI's arguments for a route query; every one
+// must be a single non-empty word, as requests to the daemon and the
+// zygote are lines of words
+func routeArgs(start, end, mode string, options []string) ([]string, error) {
+	args := append([]string{start, end, mode}, options...)
+	for _, arg := range args {
+		if arg == "" || strings.ContainsAny(arg, " \t\r\n") {
+			return nil, fmt.Errorf("invalid routing argument %q", arg)
+		}
+	}
+	return args, nil
+}
+
+// GetReachable runs the routing CLI in isochrone mode, in a child of the
+// routing zygote (zygote.go), and returns the JSON list of stations
+// reachable from start within the time and fare budgets.
+func GetReachable(start, maxTime, maxCost string) ([]byte, error) {
+	args, err := routeArgs(start, maxTime, maxCost, nil)
 	if err != nil {
-		// include the CLI’s stderr in your Go error
-		return nil, fmt.Errorf("routing binary failed: %w\noutput:\n%s", err, out)
+		return nil, err
+	}
+	status, out, errOut, err := forker.run(append([]string{"isochrone"}, args...), nil)
+	if err != nil {
+		return nil, err
+	}
+	if status != 0 {
+		return nil, fmt.Errorf("routing binary failed: exit status %d\noutput:\n%s", status, append(out, errOut...))
+	}
+	return out, nil
+}
+
+// GetRoutes runs the routing CLI in batch mode, in a child of the routing
+// zygote, over the given (start, end) pairs and returns its output in the
+// requested format ("ndjson" or "matrix").
+func GetRoutes(pairs [][2]string, format string) ([]byte, error) {
+	var input bytes.Buffer
+	for i, p := range pairs {
+		// each pair is one "start end" line of the CLI's input, so anything
+		// but two integers could split into or merge with other pairs
+		for _, id := range p {
+			if _, err := strconv.ParseInt(id, 10, 64); err != nil {
+				return nil, fmt.Errorf("pair %d: invalid station id %q", i, id)
+			}
+		}
+		fmt.Fprintf(&input, "%s %s\n", p[0], p[1])
+	}
+
+	// stderr comes apart, so a binary matrix on stdout stays intact
+	status, out, errOut, err := forker.run([]string{"batch", "-", "--format=" + format}, input.Bytes())
+	if err != nil {
+		return nil, err
+	}
+	if status != 0 {
+		return nil, fmt.Errorf("routing binary failed: exit status %d\noutput:\n%s", status, errOut)
 	}
 	return out, nil
 }
@@ -0,0 +1,121 @@
+package routing
+
+import (
+	"bufio"
+	"fmt"
+	"io"
+	"net"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+	"sync"
+)
+
+// zygote is one long-lived `routing zygote` process that loads the network
+// and precomputed files once and forks a child for each request, which
+// starts with them already in memory (shared copy-on-write) instead of
+// reading them from disk like a freshly exec'd CLI. It is started on first
+// use and again when it can no longer be reached, and stops when this
+// process exits and its stdin closes.
+type zygote struct {
+	mu     sync.Mutex // guards the fields below
+	socket string
+	stdin  io.WriteCloser
+}
+
+var forker zygote
+
+// run runs the routing CLI with args and stdin in a child of the zygote
+// and returns its exit status, stdout and stderr
+func (z *zygote) run(args []string, stdin []byte) (int, []byte, []byte, error) {
+	conn, err := z.dial()
+	if err != nil {
+		return 0, nil, nil, err
+	}
+	defer conn.Close()
+
+	request := append([]byte(strings.Join(args, " ")+"\n"), stdin...)
+	if _, err := conn.Write(request); err != nil {
+		return 0, nil, nil, fmt.Errorf("routing zygote failed: %w", err)
+	}
+	if err := conn.CloseWrite(); err != nil {
+		return 0, nil, nil, fmt.Errorf("routing zygote failed: %w", err)
+	}
+
+	reader := bufio.NewReader(conn)
+	header, err := reader.ReadString('\n')
+	if err != nil {
+		return 0, nil, nil, fmt.Errorf("routing zygote failed: %w", err)
+	}
+	var status, outLength, errLength int
+	if _, err := fmt.Sscanf(header, "%d %d %d\n", &status, &outLength, &errLength); err != nil {
+		return 0, nil, nil, fmt.Errorf("routing zygote sent a malformed answer %q", header)
+	}
+	answer := make([]byte, outLength+errLength)
+	if _, err := io.ReadFull(reader, answer); err != nil {
+		return 0, nil, nil, fmt.Errorf("routing zygote failed: %w", err)
+	}
+	return status, answer[:outLength], answer[outLength:], nil
+}
+
+// dial connects to the zygote, starting it when it is not running
+func (z *zygote) dial() (*net.UnixConn, error) {
+	z.mu.Lock()
+	if z.stdin == nil {
+		if err := z.start(); err != nil {
+			z.mu.Unlock()
+			return nil, err
+		}
+	}
+	socket := z.socket
+	z.mu.Unlock()
+
+	conn, err := net.DialUnix("unix", nil, &net.UnixAddr{Name: socket, Net: "unix"})
+	if err == nil {
+		return conn, nil
+	}
+
+	// it exited: start another, unless a concurrent caller already has
+	z.mu.Lock()
+	defer z.mu.Unlock()
+	if z.stdin != nil && z.socket == socket {
+		z.stdin.Close()
+		z.stdin = nil
+	}
+	if z.stdin == nil {
+		if err := z.start(); err != nil {
+			return nil, err
+		}
+	}
+	return net.DialUnix("unix", nil, &net.UnixAddr{Name: z.socket, Net: "unix"})
+}
+
+// start launches the zygote and waits until it accepts connections; z.mu
+// is held
+func (z *zygote) start() error {
+	socket := filepath.Join(os.TempDir(), fmt.Sprintf("tram_routing_%d.sock", os.Getpid()))
+	cmd := exec.Command("./cpp_binaries/routing", "zygote", "--socket="+socket)
+	cmd.Stderr = os.Stderr
+	stdin, err := cmd.StdinPipe()
+	if err != nil {
+		return err
+	}
+	stdout, err := cmd.StdoutPipe()
+	if err != nil {
+		return err
+	}
+	if err := cmd.Start(); err != nil {
+		return fmt.Errorf("routing zygote failed to start: %w", err)
+	}
+
+	// it prints "ready" once it listens, and nothing else
+	if line, _ := bufio.NewReader(stdout).ReadString('\n'); line != "ready\n" {
+		stdin.Close()
+		cmd.Wait()
+		return fmt.Errorf("routing zygote exited before it was ready")
+	}
+	go cmd.Wait()
+	z.socket, z.stdin = socket, stdin
+	return nil
+}